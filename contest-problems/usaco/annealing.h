@@ -0,0 +1,65 @@
+// Simulated-annealing engine shared by the subsequence-reversal solvers.
+//
+// The problem is supplied as policy types, so every call inlines:
+//
+//   Moves      typedef ... Move;
+//              void propose(const State &, double temperature, Move &)
+//              void apply(State &, const Move &)
+//              void undo(State &, const Move &)
+//   Evaluator  int evaluate(const State &)   score of the state just moved to;
+//                                            may reuse work since the last commit
+//              void commit()                 that state was accepted
+//   Schedule   double temperature() const
+//              void cool()
+//
+// Scores are maximised. Moves are applied in place and undone on rejection,
+// so a step never copies the state.
+#ifndef SUBREV_ANNEALING_H
+#define SUBREV_ANNEALING_H
+
+#include <cmath>
+
+#include "solver.h"
+#include "telemetry.h"
+
+struct GeometricCooling {
+  double t;
+  double factor;
+
+  double temperature() const { return t; }
+  void cool() { t *= factor; }
+};
+
+// Runs the Metropolis loop from `state`, whose score is `score`, until
+// `control` stops it. `uniform` draws the acceptance threshold in [0, 1).
+// Returns the number of evaluations, which are also added to `control`.
+template <class State, class Moves, class Evaluator, class Schedule, class Uniform>
+long long anneal(State &state, int score, Moves &moves, Evaluator &evaluator,
+                 Schedule &schedule, Uniform &&uniform, SolveControl &control) {
+  typename Moves::Move move;
+  Telemetry *const telemetry = control.telemetry();
+  long long evals = 0, accepted = 0;
+  while (!control.should_stop(evals)) {
+    evals++;
+    const double t = schedule.temperature();
+    moves.propose(state, t, move);
+    moves.apply(state, move);
+    int candidate = evaluator.evaluate(state);
+    control.improve(candidate);
+    if (candidate > score || std::exp((candidate - score) / t) >= uniform()) {
+      evaluator.commit();
+      score = candidate;
+      accepted++;
+    } else {
+      moves.undo(state, move);
+    }
+    if (telemetry && telemetry->due(evals)) {
+      telemetry->record(evals, t, accepted, score, control.best());
+    }
+    schedule.cool();
+  }
+  control.add_evals(evals);
+  return evals;
+}
+
+#endif  // SUBREV_ANNEALING_H
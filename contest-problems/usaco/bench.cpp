@@ -0,0 +1,126 @@
+// Benchmarks every subsequence-reversal solver on the bundled inputs.
+//
+//   g++ -O2 -std=c++17 -pthread bench.cpp -o bench
+//   (add -DSUBREV_JIT and the LLVM flags from lis_jit.h for the jit solver)
+//   ./bench [--seeds=K] [--evals=N] [--time=S] [--cache=B] [file.txt ...]
+//
+// Each heuristic runs once per seed 1..K on every input (default: all *.txt in
+// the current directory), capped at N evaluations or S seconds, whichever
+// comes first. With an evaluation cap the single-threaded solvers are fully
+// reproducible for a given seed; the parallel one is not, since replica
+// exchanges depend on thread timing. The optimum comes from exact_solve, or
+// for n > 255 from lis_upper_bound, which may not be attainable. Inputs the
+// mask solvers cannot take (n > 50 or values outside 1..50) only run
+// bitset_annealing_solve.
+// --cache sets the evaluation cache to 2^B slots (0 turns it off); hit% is
+// its hit rate for the solvers that use one.
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <string>
+
+#define SUBREV_NO_MAIN
+#include "subseq_reversal.cpp"
+#define PSYHO_NO_MAIN
+#include "psyho.cpp"
+
+struct Solver {
+  const char *name;
+  function<int(const vector<int> &, const SolveOptions &)> solve;
+};
+
+int main(int argc, char **argv) {
+  int num_seeds = 10;
+  SolveOptions base;
+  base.max_evals = 200000;
+  base.time_limit = 2.0;
+  vector<string> files;
+  for (int a = 1; a < argc; a++) {
+    string arg = argv[a];
+    if (arg.rfind("--seeds=", 0) == 0) {
+      num_seeds = stoi(arg.substr(8));
+    } else if (arg.rfind("--evals=", 0) == 0) {
+      base.max_evals = stoll(arg.substr(8));
+    } else if (arg.rfind("--time=", 0) == 0) {
+      base.time_limit = stod(arg.substr(7));
+    } else if (arg.rfind("--cache=", 0) == 0) {
+      base.cache_log_size = stoi(arg.substr(8));
+    } else {
+      files.push_back(arg);
+    }
+  }
+  if (files.empty()) {
+    for (const auto &entry : filesystem::directory_iterator(".")) {
+      if (entry.path().extension() == ".txt") {
+        files.push_back(entry.path().filename().string());
+      }
+    }
+    sort(files.begin(), files.end());
+  }
+
+  vector<Solver> solvers = {
+      {"anneal", [](const vector<int> &in, const SolveOptions &o) {
+         return simulated_annealing_solve(in, o);
+       }},
+      {"batch", [](const vector<int> &in, const SolveOptions &o) {
+         return batch_annealing_solve(in, o);
+       }},
+      {"parallel", [](const vector<int> &in, const SolveOptions &o) {
+         return parallel_tempering_solve(in, o);
+       }},
+      {"psyho", [](const vector<int> &in, const SolveOptions &o) {
+         return psyho::solve(in, o);
+       }},
+#ifdef SUBREV_JIT
+      {"jit", [](const vector<int> &in, const SolveOptions &o) {
+         return jit_annealing_solve(in, o);
+       }},
+#endif
+  };
+  const vector<Solver> long_solvers = {
+      {"bitset", [](const vector<int> &in, const SolveOptions &o) {
+         return bitset_annealing_solve(in, o);
+       }},
+  };
+
+  cout << left << setw(8) << "input" << setw(10) << "solver" << right
+       << setw(9) << "success" << setw(14) << "evals/sec" << setw(14)
+       << "t_best_avg" << setw(14) << "t_best_max" << setw(8) << "hit%" << endl;
+  for (const string &file : files) {
+    ifstream in(file);
+    vector<int> arr;
+    if (!read_instance(in, arr)) {
+      cerr << file << ": cannot read instance" << endl;
+      continue;
+    }
+    const bool fits = fits_mask_solvers(arr);
+    const int optimum =
+        fits_exact_solver(arr) ? exact_solve(arr) : lis_upper_bound(arr);
+    for (const Solver &solver : fits ? solvers : long_solvers) {
+      int hits = 0;
+      long long evals = 0, lookups = 0, cache_hits = 0;
+      double seconds = 0, ttb_sum = 0, ttb_max = 0;
+      for (int seed = 1; seed <= num_seeds; seed++) {
+        SolveStats stats;
+        SolveOptions opts = base;
+        opts.seed = seed;
+        opts.stats = &stats;
+        int got = solver.solve(arr, opts);
+        hits += got == optimum;
+        evals += stats.evals;
+        seconds += stats.seconds;
+        ttb_sum += stats.time_to_best;
+        ttb_max = max(ttb_max, stats.time_to_best);
+        lookups += stats.cache_lookups;
+        cache_hits += stats.cache_hits;
+      }
+      cout << left << setw(8) << file << setw(10) << solver.name << right
+           << setw(5) << hits << "/" << left << setw(3) << num_seeds << right
+           << fixed << setprecision(0) << setw(14) << evals / max(seconds, 1e-9)
+           << setprecision(4) << setw(14) << ttb_sum / num_seeds << setw(14)
+           << ttb_max << setprecision(1) << setw(8)
+           << 100.0 * cache_hits / max(lookups, 1LL) << endl;
+    }
+  }
+  return 0;
+}
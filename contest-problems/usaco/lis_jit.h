@@ -0,0 +1,197 @@
+// LIS evaluator compiled with LLVM for one input, on the LLJIT + O3
+// PassBuilder setup of llvm-experiment/fourth.cpp. subseq_reversal.cpp only
+// includes it when built with -DSUBREV_JIT:
+//
+//   g++ -O2 -DSUBREV_JIT subseq_reversal.cpp
+//       $(llvm-config --cxxflags --ldflags --libs core orcjit native passes)
+//       -std=c++17 -pthread
+//
+// (one command, split here only for width)
+//
+// The generated `int32_t lis(int64_t mask)` has n and the input values baked
+// in as constants and is fully unrolled. One pass places the reversed values.
+// The other runs LisEvaluator's row recurrence with the row held in a single
+// vector register, sized to the largest value. A scalar O(n^2) DP, n^2
+// selects in one block, takes the backend most of a second at n = 30.
+#ifndef SUBREV_LIS_JIT_H
+#define SUBREV_LIS_JIT_H
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "solver.h"
+
+class JitLisEvaluator {
+ public:
+  // Compiles the evaluator for `input` (n <= 63, values in 0..63); check ok().
+  explicit JitLisEvaluator(const std::vector<int> &input) {
+    Stopwatch watch;
+    compile(input);
+    compile_seconds_ = watch.elapsed();
+  }
+
+  bool ok() const { return fn_ != nullptr; }
+  double compile_seconds() const { return compile_seconds_; }
+
+  // anneal() Evaluator interface; the compiled function keeps no state.
+  int evaluate(long long mask) { return fn_(mask); }
+  void commit() {}
+
+ private:
+  typedef int32_t (*LisFn)(int64_t);
+
+  void compile(const std::vector<int> &input) {
+    static std::once_flag init;
+    std::call_once(init, [] {
+      llvm::InitializeNativeTarget();
+      llvm::InitializeNativeTargetAsmPrinter();
+      llvm::InitializeNativeTargetAsmParser();
+    });
+
+    auto JTMB = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!JTMB) {
+      llvm::errs() << "detectHost failed: " << llvm::toString(JTMB.takeError()) << "\n";
+      return;
+    }
+#if LLVM_VERSION_MAJOR >= 18
+    JTMB->setCodeGenOptLevel(llvm::CodeGenOptLevel::Aggressive);
+#else
+    JTMB->setCodeGenOptLevel(llvm::CodeGenOpt::Aggressive);
+#endif
+    auto J = llvm::orc::LLJITBuilder().setJITTargetMachineBuilder(std::move(*JTMB)).create();
+    if (!J) {
+      llvm::errs() << "LLJITBuilder failed: " << llvm::toString(J.takeError()) << "\n";
+      return;
+    }
+    jit_ = std::move(*J);
+
+    auto C = std::make_unique<llvm::LLVMContext>();
+    auto M = std::make_unique<llvm::Module>("lis_jit", *C);
+    M->setDataLayout(jit_->getDataLayout());
+    buildLis(*M, *C, input);
+    optimize(*M);
+    llvm::orc::ThreadSafeModule TSM(std::move(M), std::move(C));
+    if (auto Err = jit_->addIRModule(std::move(TSM))) {
+      llvm::errs() << "addIRModule failed: " << llvm::toString(std::move(Err)) << "\n";
+      return;
+    }
+    auto Sym = jit_->lookup("lis");
+    if (!Sym) {
+      llvm::errs() << "lookup failed: " << llvm::toString(Sym.takeError()) << "\n";
+      return;
+    }
+#if LLVM_VERSION_MAJOR >= 17
+    fn_ = Sym->toPtr<LisFn>();
+#else
+    fn_ = reinterpret_cast<LisFn>(Sym->getAddress());
+#endif
+  }
+
+  // int32_t lis(int64_t mask): LIS of the input with the positions in `mask`
+  // reversed. Values and lengths are i8.
+  static void buildLis(llvm::Module &M, llvm::LLVMContext &C,
+                       const std::vector<int> &input) {
+    const int n = input.size();
+    llvm::Type *i8 = llvm::Type::getInt8Ty(C);
+    llvm::Type *i32 = llvm::Type::getInt32Ty(C);
+    llvm::Type *i64 = llvm::Type::getInt64Ty(C);
+    auto *FT = llvm::FunctionType::get(i32, {i64}, false);
+    auto *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "lis", M);
+    llvm::IRBuilder<> B(llvm::BasicBlock::Create(C, "entry", F));
+    llvm::Value *mask = F->getArg(0);
+
+    // Pass 1: push the selected values in order. Every position stores at the
+    // current top and only bumps it when selected, so there are no branches.
+    llvm::Type *stackTy = llvm::ArrayType::get(i8, n + 1);
+    llvm::Value *stack = B.CreateAlloca(stackTy);
+    auto slot = [&](llvm::Value *idx) {
+      return B.CreateInBoundsGEP(stackTy, stack, {B.getInt32(0), idx});
+    };
+    std::vector<llvm::Value *> bit(n);
+    llvm::Value *top = B.getInt32(0);
+    for (int i = 0; i < n; i++) {
+      bit[i] = B.CreateTrunc(B.CreateLShr(mask, i), B.getInt1Ty());
+      B.CreateStore(B.getInt8(input[i]), slot(top));
+      top = B.CreateAdd(top, B.CreateZExt(bit[i], i32));
+    }
+
+    // Pass 2: selected positions pop from the top, giving the reversed order.
+    std::vector<llvm::Value *> x(n);
+    for (int i = 0; i < n; i++) {
+      llvm::Value *idx = B.CreateSelect(bit[i], B.CreateSub(top, B.getInt32(1)),
+                                        B.getInt32(n));
+      llvm::Value *popped = B.CreateLoad(i8, slot(idx));
+      x[i] = B.CreateSelect(bit[i], popped, B.getInt8(input[i]));
+      top = B.CreateSub(top, B.CreateZExt(bit[i], i32));
+    }
+
+    // row[v] = longest non-decreasing subsequence so far ending with a value
+    // <= v. Appending x raises row[v] to row[x] + 1 for every v >= x.
+    int maxv = 0;
+    for (int v : input) maxv = std::max(maxv, v);
+    unsigned width = 1;
+    while (width < (unsigned) maxv + 1) width <<= 1;
+    auto *vecTy = llvm::FixedVectorType::get(i8, width);
+    std::vector<llvm::Constant *> lanes;
+    for (unsigned v = 0; v < width; v++) lanes.push_back(B.getInt8(v));
+    llvm::Value *iota = llvm::ConstantVector::get(lanes);
+    llvm::Value *zero = llvm::Constant::getNullValue(vecTy);
+    llvm::Value *row = zero;
+    for (int i = 0; i < n; i++) {
+      llvm::Value *len = B.CreateAdd(B.CreateExtractElement(row, x[i]), B.getInt8(1));
+      llvm::Value *ge = B.CreateICmpUGE(iota, B.CreateVectorSplat(width, x[i]));
+      llvm::Value *raised = B.CreateSelect(ge, B.CreateVectorSplat(width, len), zero);
+      row = B.CreateBinaryIntrinsic(llvm::Intrinsic::umax, row, raised);
+    }
+    llvm::Value *ans = B.CreateExtractElement(row, (uint64_t) maxv);
+    B.CreateRet(B.CreateZExt(ans, i32));
+
+    if (llvm::verifyFunction(*F, &llvm::errs())) {
+      llvm::errs() << "Function verification failed!\n";
+    }
+  }
+
+  static void optimize(llvm::Module &M) {
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+    llvm::PassBuilder PB;
+    PB.registerModuleAnalyses(MAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+#if LLVM_VERSION_MAJOR >= 14
+    auto MPM = PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+#else
+    auto MPM = PB.buildPerModuleDefaultPipeline(llvm::PassBuilder::OptimizationLevel::O3);
+#endif
+    MPM.run(M, MAM);
+  }
+
+  std::unique_ptr<llvm::orc::LLJIT> jit_;
+  LisFn fn_ = nullptr;
+  double compile_seconds_ = 0;
+};
+
+#endif  // SUBREV_LIS_JIT_H
@@ -1,54 +1,69 @@
 // Psyho's solution to https://usaco.org/index.php?page=viewproblem2&cpid=698
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <iostream>
 #include <random>
 #include <vector>
 
+#include "annealing.h"
+#include "rng.h"
+#include "solver.h"
+
 using namespace std;
 
+namespace psyho {
+
 typedef long long ll;
 
 const int N = 51;
-int was[N];
 int cur[N];
 int a[N];
 int lul[N];
 int dp[N];
-double temp = 1;
 double t0 = 1e9;
 
-int main()
+// Moves flip n * temp / t0 random entries of lul[]; undo flips them back.
+struct Flips
 {
-    srand(2);
-    ios::sync_with_stdio(0);
+    typedef vector<uint32_t> Move;
+
     int n;
-    cin >> n;
-    for (int i = 0; i < n; i++)
+    Rng &rng;
+
+    void propose(const int (&)[N], double temp, Move &move)
     {
-        lul[i] = rand() % 2;
-        cin >> a[i];
+        // As many flips as `for (it = 0; it < n * temp / t0; it++)` would make.
+        move.resize(max(0, (int) ceil(n * temp / t0)));
+        rng.fill_bounded(n, move.data(), move.size());
     }
-    temp = t0;
-    int ans = 0;
-    int cur = 0;
-    int num_eval = 0;
-    while (clock() / (double) CLOCKS_PER_SEC <= 1.99)
+    void apply(int (&state)[N], const Move &move)
     {
-        num_eval++;
-        vector <int> p;
-        for (int i = 0; i < n; i++)
-        {
-            was[i] = lul[i];
-        }
-        for (int it = 0; it < n * temp / t0; it++)
+        for (uint32_t i : move)
         {
-            lul[rand() % n] ^= 1;
+            state[i] ^= 1;
         }
+    }
+    void undo(int (&state)[N], const Move &move)
+    {
+        apply(state, move);
+    }
+};
+
+// Reverses the marked entries of a[] into cur[] and runs the O(n^2) LIS.
+struct Lis
+{
+    int n;
+    vector <int> p;
+
+    int evaluate(const int (&state)[N])
+    {
+        p.clear();
         for (int i = 0; i < n; i++)
         {
-            if (lul[i])
+            cur[i] = a[i];
+            if (state[i])
             {
                 p.push_back(i);
             }
@@ -56,7 +71,7 @@ int main()
         int t = p.size();
         for (int i = 0; i < t / 2; i++)
         {
-            swap(a[p[i]], a[p[t - 1 - i]]);
+            swap(cur[p[i]], cur[p[t - 1 - i]]);
         }
         int kek = 0;
         for (int i = 0; i < n; i++)
@@ -64,42 +79,55 @@ int main()
             dp[i] = 1;
             for (int j = 0; j < i; j++)
             {
-                if (a[j] <= a[i])
+                if (cur[j] <= cur[i])
                 {
                     dp[i] = max(dp[i], dp[j] + 1);
                 }
             }
             kek = max(kek, dp[i]);
         }
-        ans = max(ans, kek);
-        for (int i = 0; i < t / 2; i++)
-        {
-            swap(a[p[i]], a[p[t - 1 - i]]);
-        }
-        if (kek > cur)
-        {
-            cur = kek;
-        }
-        else
-        {
-            double t = exp((kek - cur) / temp);
-            int x = 1 + rand();
-            int y = 1 + rand();
-            x %= y;
-            if (x / (double) y <= t)
-            {
-                cur = kek;
-            }
-            else
-            {
-                for (int i = 0; i < n; i++)
-                {
-                    lul[i] = was[i];
-                }
-            }
-        }
-        temp *= 0.9999;
+        return kek;
+    }
+    void commit()
+    {
+    }
+};
+
+int solve(const vector<int> &input, const SolveOptions &opts = SolveOptions())
+{
+    SolveControl control(opts, input);
+    Rng rng(opts.seed != 0 ? opts.seed : 2);
+    int n = input.size();
+    for (int i = 0; i < n; i++)
+    {
+        lul[i] = rng.next() & 1;
+        a[i] = input[i];
+    }
+    Flips moves{n, rng};
+    Lis lis{n, {}};
+    GeometricCooling schedule{t0, 0.9999};
+    anneal(lul, 0, moves, lis, schedule, [&] { return rng.uniform(); }, control);
+    return control.finish();
+}
+
+}  // namespace psyho
+
+#ifndef PSYHO_NO_MAIN
+int main()
+{
+    ios::sync_with_stdio(0);
+    int n;
+    cin >> n;
+    vector<int> input(n);
+    for (int i = 0; i < n; i++)
+    {
+        cin >> input[i];
     }
-    cout << ans << '\n';
-    cerr << num_eval << endl;
+    SolveOptions opts;
+    opts.time_limit = 1.99;
+    SolveStats stats;
+    opts.stats = &stats;
+    cout << psyho::solve(input, opts) << '\n';
+    cerr << stats.evals << endl;
 }
+#endif  // PSYHO_NO_MAIN
@@ -0,0 +1,131 @@
+// Seedable random numbers for the solver hot loops.
+//
+// xoshiro256++ run as LANES independent streams in struct-of-arrays layout.
+// Each state word is a GCC vector holding one value per lane, so a step
+// advances every lane with the same SIMD ops even at -O2. Outputs are
+// buffered and handed out as raw words, bounded integers (Lemire's
+// multiply-shift, unbiased) or doubles in [0, 1), one at a time or a whole
+// array per call. An Rng is not thread safe; give each thread its own.
+#ifndef SUBREV_RNG_H
+#define SUBREV_RNG_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+class Rng {
+ public:
+  static const int LANES = 4;
+
+  // Different (seed, stream) pairs give unrelated sequences.
+  explicit Rng(uint64_t seed, uint64_t stream = 0) {
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    for (int w = 0; w < 4; w++) {
+      for (int l = 0; l < LANES; l++) {
+        s_[w][l] = splitmix64(x);
+      }
+    }
+  }
+
+  uint64_t next() {
+    if (pos_ == BUFFER) refill();
+    return buf_[pos_++];
+  }
+
+  uint32_t bounded(uint32_t bound) {
+    uint32_t out;
+    fill_bounded(bound, &out, 1);
+    return out;
+  }
+
+  double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+  // out[i] uniform in [0, bound), bound > 0.
+  void fill_bounded(uint32_t bound, uint32_t *out, size_t count) {
+    while (count > 0) {
+      if (pos_ == BUFFER) refill();
+      const size_t take = std::min(count, BUFFER - pos_);
+      const uint64_t *words = buf_ + pos_;
+      bool suspect = false;
+      for (size_t k = 0; k < take; k++) {
+        uint64_t m = (words[k] >> 32) * bound;
+        out[k] = m >> 32;
+        suspect |= (uint32_t) m < bound;
+      }
+      if (suspect) {
+        // Redraw the few products that fall in the biased low range.
+        const uint32_t threshold = -bound % bound;
+        for (size_t k = 0; k < take; k++) {
+          uint64_t m = (words[k] >> 32) * bound;
+          while ((uint32_t) m < threshold) {
+            Lanes fresh;
+            step(fresh);
+            m = (fresh[0] >> 32) * bound;
+          }
+          out[k] = m >> 32;
+        }
+      }
+      pos_ += take;
+      out += take;
+      count -= take;
+    }
+  }
+
+  // out[i] uniform in [0, 1).
+  void fill_uniform(double *out, size_t count) {
+    while (count > 0) {
+      if (pos_ == BUFFER) refill();
+      const size_t take = std::min(count, BUFFER - pos_);
+      for (size_t k = 0; k < take; k++) {
+        out[k] = (buf_[pos_ + k] >> 11) * 0x1.0p-53;
+      }
+      pos_ += take;
+      out += take;
+      count -= take;
+    }
+  }
+
+ private:
+  typedef uint64_t Lanes __attribute__((vector_size(LANES * sizeof(uint64_t))));
+
+  static const size_t STEPS = 16;
+  static const size_t BUFFER = STEPS * LANES;
+
+  static uint64_t splitmix64(uint64_t &x) {
+    uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // Lanes never cross a function boundary by value: without AVX that would
+  // change the calling convention, and GCC warns about it.
+  void step(Lanes &out) {
+    Lanes &s0 = s_[0], &s1 = s_[1], &s2 = s_[2], &s3 = s_[3];
+    const Lanes sum = s0 + s3;
+    out = ((sum << 23) | (sum >> 41)) + s0;
+    const Lanes t = s1 << 17;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = (s3 << 45) | (s3 >> 19);
+  }
+
+  void refill() {
+    for (size_t i = 0; i < STEPS; i++) {
+      Lanes out;
+      step(out);
+      memcpy(buf_ + i * LANES, &out, sizeof(out));
+    }
+    pos_ = 0;
+  }
+
+  Lanes s_[4];
+  uint64_t buf_[BUFFER];
+  size_t pos_ = BUFFER;
+};
+
+#endif  // SUBREV_RNG_H
@@ -0,0 +1,192 @@
+// Options and statistics shared by the subsequence-reversal solvers
+// (subseq_reversal.cpp, psyho.cpp) and the benchmark harness (bench.cpp).
+#ifndef SUBREV_SOLVER_H
+#define SUBREV_SOLVER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class Telemetry;  // telemetry.h
+
+struct Stopwatch {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  double elapsed() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+        .count();
+  }
+};
+
+struct SolveStats {
+  long long evals = 0;       // candidate states scored
+  double seconds = 0;        // wall time of the whole run
+  double time_to_best = 0;   // wall time at which `best` was first reached
+  int best = 0;
+  bool proven_optimal = false;  // stopped because best reached the upper bound
+  long long cache_lookups = 0;  // evaluation cache, for solvers that use one
+  long long cache_hits = 0;
+
+  void improve(int value, const Stopwatch &watch) {
+    if (value > best) {
+      best = value;
+      time_to_best = watch.elapsed();
+    }
+  }
+};
+
+struct SolveOptions {
+  double time_limit = 1.95;   // wall-clock seconds
+  long long max_evals = -1;   // stop after this many evaluations, -1 = no cap
+  uint64_t seed = 0;          // 0 = seed from std::random_device
+  SolveStats *stats = nullptr;
+  int cache_log_size = 16;    // 2^k evaluation cache slots, 0 = no cache
+
+  // Stop as soon as the best value reaches this. -1 = lis_upper_bound(input).
+  int upper_bound = -1;
+  // Stop once this many seconds pass without a new best. -1 = never.
+  double stall_limit = -1;
+  // Polled by the solver; set it from another thread to stop early.
+  const std::atomic<bool> *cancel = nullptr;
+  // Called with (best, elapsed seconds) whenever the best value improves.
+  // May be called from solver threads, but never concurrently.
+  std::function<void(int, double)> on_progress;
+  // If set, anneal() records samples of the run here (single-chain solvers).
+  Telemetry *telemetry = nullptr;
+
+  bool evals_exhausted(long long evals) const {
+    return max_evals >= 0 && evals >= max_evals;
+  }
+};
+
+// Upper bound on the answer without solving it. In the final arrangement, a
+// non-decreasing subsequence splits into elements that stayed in place (a
+// non-decreasing subsequence of the input) and elements that came from the
+// reversed subsequence (in input order, a non-increasing one). So the answer
+// is at most LIS(input) + LNIS(input), and trivially at most n.
+inline int lis_upper_bound(const std::vector<int> &input) {
+  auto longest = [&](bool increasing) {
+    std::vector<int> tails;
+    for (int x : input) {
+      int key = increasing ? x : -x;
+      auto it = std::upper_bound(tails.begin(), tails.end(), key);
+      if (it == tails.end()) {
+        tails.push_back(key);
+      } else {
+        *it = key;
+      }
+    }
+    return (int) tails.size();
+  };
+  return std::min<int>(input.size(), longest(true) + longest(false));
+}
+
+// One solver run against its SolveOptions: steady-clock deadline, evaluation
+// cap, cancellation, stall limit, early exit at the upper bound and progress
+// reporting.
+// Safe to share between the threads of a parallel solver.
+class SolveControl {
+ public:
+  SolveControl(const SolveOptions &opts, const std::vector<int> &input)
+      : opts_(opts),
+        bound_(opts.upper_bound >= 0 ? opts.upper_bound : lis_upper_bound(input)),
+        deadline_(watch_.start +
+                  std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(opts.time_limit))),
+        stall_(opts.stall_limit >= 0
+                   ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                         std::chrono::duration<double>(opts.stall_limit))
+                   : std::chrono::steady_clock::duration::max()),
+        last_improve_(watch_.start.time_since_epoch().count()) {}
+
+  // `evals` is the caller's own count; the clock and the cancel flag are only
+  // read every 16 evaluations to keep this off the hot path.
+  bool should_stop(long long evals) const {
+    if (done_.load(std::memory_order_relaxed) || opts_.evals_exhausted(evals)) {
+      return true;
+    }
+    if ((evals & poll_mask_) != 0) {
+      return false;
+    }
+    if (opts_.cancel && opts_.cancel->load(std::memory_order_relaxed)) {
+      return true;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::steady_clock::time_point last(
+        std::chrono::steady_clock::duration(last_improve_.load(std::memory_order_relaxed)));
+    return now >= deadline_ || now - last > stall_;
+  }
+
+  // Records a candidate value. Returns true once it proves optimality.
+  bool improve(int value) {
+    int seen = best_.load(std::memory_order_relaxed);
+    while (value > seen) {
+      if (best_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        last_improve_.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                            std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.improve(value, watch_);
+        if (opts_.on_progress) {
+          opts_.on_progress(value, watch_.elapsed());
+        }
+        if (value >= bound_) {
+          stats_.proven_optimal = true;
+          done_.store(true, std::memory_order_relaxed);
+        }
+        break;
+      }
+    }
+    return done_.load(std::memory_order_relaxed);
+  }
+
+  // For solvers whose evaluations are slow enough to matter against the
+  // deadline.
+  void poll_every_eval() { poll_mask_ = 0; }
+
+  void add_evals(long long evals) { evals_ += evals; }
+  void add_cache_stats(long long lookups, long long hits) {
+    cache_lookups_ += lookups;
+    cache_hits_ += hits;
+  }
+
+  int best() const { return best_.load(); }
+  Telemetry *telemetry() const { return opts_.telemetry; }
+  int upper_bound() const { return bound_; }
+  double elapsed() const { return watch_.elapsed(); }
+
+  // Publishes the statistics, if requested, and returns the best value.
+  int finish() {
+    if (opts_.stats) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      *opts_.stats = stats_;
+      opts_.stats->evals = evals_.load();
+      opts_.stats->cache_lookups = cache_lookups_.load();
+      opts_.stats->cache_hits = cache_hits_.load();
+      opts_.stats->seconds = watch_.elapsed();
+    }
+    return best_.load();
+  }
+
+ private:
+  const SolveOptions &opts_;
+  Stopwatch watch_;
+  const int bound_;
+  const std::chrono::steady_clock::time_point deadline_;
+  const std::chrono::steady_clock::duration stall_;
+  // steady_clock ticks of the latest improvement, for the stall limit.
+  std::atomic<std::chrono::steady_clock::rep> last_improve_;
+  long long poll_mask_ = 15;
+  std::atomic<int> best_{0};
+  std::atomic<long long> evals_{0};
+  std::atomic<long long> cache_lookups_{0};
+  std::atomic<long long> cache_hits_{0};
+  std::atomic<bool> done_{false};
+  std::mutex mutex_;
+  SolveStats stats_;
+};
+
+#endif  // SUBREV_SOLVER_H
@@ -1,46 +1,77 @@
 // https://usaco.org/index.php?page=viewproblem2&cpid=698
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <vector>
 
+#include "annealing.h"
+#include "rng.h"
+#ifdef SUBREV_JIT
+#include "lis_jit.h"
+#endif
+#include "solver.h"
+#include "telemetry.h"
+
 using namespace std;
 
-std::uniform_int_distribution<long long> distrib;
-std::uniform_real_distribution<double> dbl_distrib;
-// 1. Obtain a seed from the system's random device
-// random_device produces non-deterministic results if available
+// Seeds runs that do not ask for a fixed seed. The solvers draw from their
+// own Rng (rng.h).
 std::random_device rd;
-// 2. Seed a high-quality 64-bit Mersenne Twister engine
-// std::mt19937_64 is preferred for 64-bit random numbers
-std::mt19937_64 gen(rd());
 
-void init() {
-  //  Define the desired range (e.g., from 0 to the maximum possible long long)
-  long long min_val = 0;
-  long long max_val = std::numeric_limits<long long>::max();
-  // Define the distribution
-  distrib = std::uniform_int_distribution<long long>(min_val, max_val);
-  dbl_distrib = std::uniform_real_distribution<double>(0.0, 1.0);
+// Longest non-decreasing subsequence by patience sorting, O(n log n) for any
+// values. tails[k] is the smallest value that ends such a subsequence of
+// length k + 1; it is scratch space so callers in a loop can reuse it.
+int patience_lis(const vector<int> &input, vector<int> &tails) {
+  tails.clear();
+  for (int x : input) {
+    auto it = upper_bound(tails.begin(), tails.end(), x);
+    if (it == tails.end()) {
+      tails.push_back(x);
+    } else {
+      *it = x;
+    }
+  }
+  return tails.size();
 }
 
 int compute_lis(const vector<int> &input) {
-  if (input.empty()) return 0;
-  // dp[v] = max LIS length ending with value v
-  int dp[51] = {0};
-  int ans = 0;
-  for (int x : input) {
-    int best = 0;
-    for (int v = 1; v <= x; v++) {
-      best = max(best, dp[v]);
+  vector<int> tails;
+  return patience_lis(input, tails);
+}
+
+// Reversal set for instances longer than a long long mask can hold.
+struct DynamicBitset {
+  explicit DynamicBitset(int n = 0) : n(n), words((n + 63) / 64) {}
+
+  int size() const { return n; }
+  bool test(int i) const { return words[i >> 6] >> (i & 63) & 1; }
+  void flip(int i) { words[i >> 6] ^= 1ULL << (i & 63); }
+
+  // Calls f(i) for every set bit i, in increasing order.
+  template <class F>
+  void for_each(F f) const {
+    for (size_t w = 0; w < words.size(); w++) {
+      for (uint64_t bits = words[w]; bits != 0; bits &= bits - 1) {
+        f((int) (w * 64 + __builtin_ctzll(bits)));
+      }
     }
-    dp[x] = max(dp[x], best + 1);
-    ans = max(ans, dp[x]);
   }
-  return ans;
-}
+
+ private:
+  int n;
+  vector<uint64_t> words;
+};
 
 vector<int> reverse_subsequence(const vector<int> &input, long long mask) {
   int n = input.size();
@@ -62,6 +93,369 @@ vector<int> reverse_subsequence(const vector<int> &input, long long mask) {
   return result;
 }
 
+vector<int> reverse_subsequence(const vector<int> &input, const DynamicBitset &set) {
+  vector<int> result(input);
+  vector<int> indices;
+  set.for_each([&](int i) { indices.push_back(i); });
+  int left = 0, right = indices.size() - 1;
+  while (left < right) {
+    swap(result[indices[left]], result[indices[right]]);
+    left++;
+    right--;
+  }
+  return result;
+}
+
+// Evaluator policy for anneal() on a DynamicBitset: rebuilds the arrangement
+// and runs patience_lis, O(n log n) per call, reusing its buffers. There is
+// no incremental update, since one flipped bit shifts every reversed value
+// after it.
+struct PatienceEvaluator {
+  explicit PatienceEvaluator(const vector<int> &input) : input(input), arr(input) {}
+
+  int evaluate(const DynamicBitset &set) {
+    indices.clear();
+    set.for_each([&](int i) { indices.push_back(i); });
+    copy(input.begin(), input.end(), arr.begin());
+    int left = 0, right = indices.size() - 1;
+    while (left < right) {
+      swap(arr[indices[left]], arr[indices[right]]);
+      left++;
+      right--;
+    }
+    return patience_lis(arr, tails);
+  }
+  void commit() {}
+
+ private:
+  const vector<int> &input;
+  vector<int> arr, indices, tails;
+};
+
+// Evaluates compute_lis(reverse_subsequence(input, mask)) without allocating.
+//
+// Keeps the arrangement and the per-prefix DP rows of the last committed mask.
+// rows[i][v] is the longest non-decreasing subsequence among the first i
+// elements that ends with a value <= v, so rows[i + 1] only depends on rows[i]
+// and the i-th element. A candidate recomputes rows starting at the first
+// position where its arrangement differs from the committed one, and stops as
+// soon as a row past the last difference matches the committed row again.
+//
+// Usage: reset(mask) once, then evaluate(candidate) and commit() on accept.
+struct LisEvaluator {
+  static const int MAXV = 50;
+  // One cache line per row. GCC vector extension so step() is a handful of
+  // SIMD ops even at -O2, where the loop vectorizer would leave it scalar.
+  typedef uint8_t Row __attribute__((vector_size(64)));
+
+  explicit LisEvaluator(const vector<int> &input)
+      : n(input.size()), input(input), cur(input), cand(input), sel(n),
+        cand_sel(n), rows(n + 1), cand_rows(n + 1) {
+    for (int x = 0; x <= MAXV; x++) {
+      for (int v = 0; v < 64; v++) {
+        ge_mask[x][v] = v >= x ? 0xFF : 0;
+      }
+    }
+    reset(0);
+  }
+
+  void reset(long long mask) {
+    arrange(mask);
+    cur = cand;
+    sel.swap(cand_sel);
+    m = cand_m;
+    cur_mask = mask;
+    rows[0] = Row{};
+    for (int i = 0; i < n; i++) {
+      step(rows[i], cand[i], rows[i + 1]);
+    }
+    cur_value = rows[n][MAXV];
+    first = last = n;
+    dirty = false;
+  }
+
+  int evaluate(long long mask) {
+    arrange(mask);
+    cand_mask = mask;
+    first = 0;
+    while (first < n && cand[first] == cur[first]) first++;
+    int diff_end = n - 1;
+    while (diff_end > first && cand[diff_end] == cur[diff_end]) diff_end--;
+    return propagate(diff_end);
+  }
+
+  // Same as evaluate(committed mask ^ (1LL << bit)), but only rewrites the
+  // positions that can move: the selected ones and `bit` itself. Meant for
+  // walks that change one bit at a time (Gray code).
+  int evaluate_flip(int bit) {
+    if (dirty) {
+      cand = cur;  // a rejected evaluation left other positions behind
+    }
+    dirty = true;
+    cand_mask = cur_mask ^ (1LL << bit);
+    cand_m = 0;
+    bool inserted = false;
+    for (int j = 0; j < m; j++) {
+      if (!inserted && sel[j] >= bit) {
+        inserted = true;
+        if (sel[j] == bit) continue;  // removing it
+        cand_sel[cand_m++] = bit;
+      }
+      cand_sel[cand_m++] = sel[j];
+    }
+    if (!inserted) {
+      cand_sel[cand_m++] = bit;
+    }
+    cand[bit] = input[bit];
+    first = n;
+    int diff_end = -1;
+    auto touch = [&](int pos) {
+      if (cand[pos] != cur[pos]) {
+        first = min(first, pos);
+        diff_end = max(diff_end, pos);
+      }
+    };
+    for (int j = 0; j < cand_m; j++) {
+      cand[cand_sel[j]] = input[cand_sel[cand_m - 1 - j]];
+      touch(cand_sel[j]);
+    }
+    touch(bit);
+    return propagate(diff_end);
+  }
+
+  // Makes the last evaluated mask the committed one.
+  void commit() {
+    for (int i = first; i < last; i++) {
+      cur[i] = cand[i];
+      rows[i + 1] = cand_rows[i + 1];
+    }
+    sel.swap(cand_sel);
+    m = cand_m;
+    cur_mask = cand_mask;
+    cur_value = cand_value;
+    first = last = n;
+    dirty = false;
+  }
+
+  int value() const { return cur_value; }
+
+ private:
+  // Writes the reversed arrangement for `mask` into `cand`.
+  void arrange(long long mask) {
+    cand_m = 0;
+    for (int i = 0; i < n; i++) {
+      cand[i] = input[i];
+      if (mask & (1LL << i)) {
+        cand_sel[cand_m++] = i;
+      }
+    }
+    for (int j = 0; j < cand_m; j++) {
+      cand[cand_sel[j]] = input[cand_sel[cand_m - 1 - j]];
+    }
+    dirty = true;
+  }
+
+  // Recomputes cand_rows from `first`, given that cand and cur agree outside
+  // [first, diff_end].
+  int propagate(int diff_end) {
+    if (first >= n) {
+      first = last = n;
+      cand_value = cur_value;
+      return cand_value;
+    }
+    const Row *prev = &rows[first];
+    for (last = first; last < n; last++) {
+      step(*prev, cand[last], cand_rows[last + 1]);
+      prev = &cand_rows[last + 1];
+      if (last > diff_end && same(*prev, rows[last + 1])) {
+        // Same prefix state and same suffix from here on.
+        last++;
+        cand_value = cur_value;
+        return cand_value;
+      }
+    }
+    cand_value = cand_rows[n][MAXV];
+    return cand_value;
+  }
+
+  void step(const Row &prev, int x, Row &next) const {
+    Row cand = ge_mask[x] & (uint8_t)(prev[x] + 1);
+    next = prev > cand ? prev : cand;
+  }
+
+  static bool same(const Row &a, const Row &b) {
+    return memcmp(&a, &b, sizeof(Row)) == 0;
+  }
+
+  int n;
+  vector<int> input;
+  vector<int> cur, cand;
+  // Selected positions, ascending, of the committed and candidate masks.
+  vector<int> sel, cand_sel;
+  int m = 0, cand_m = 0;
+  long long cur_mask = 0, cand_mask = 0;
+  // cand may differ from cur outside the last evaluation's range.
+  bool dirty = false;
+  vector<Row> rows, cand_rows;
+  Row ge_mask[MAXV + 1];
+  int cur_value = 0, cand_value = 0;
+  // Rows [first + 1, last] of cand_rows are valid for the last evaluation.
+  int first = 0, last = 0;
+};
+
+// Fixed-size, direct-mapped cache from reversal mask to LIS value. A slot is
+// a single atomic word, with the mask in the low KEY_BITS bits and value + 1
+// above it (0 marks an empty slot), so replicas can share one cache without
+// locks: a racing store simply replaces the slot, and a load always sees
+// a whole entry. Requires masks below 2^KEY_BITS, i.e. n <= 58.
+struct LisCache {
+  static const int KEY_BITS = 58;
+
+  explicit LisCache(int log_size) : shift(64 - log_size), slots(size_t(1) << log_size) {}
+
+  bool lookup(long long mask, int &value) const {
+    uint64_t entry = slots[index(mask)].load(memory_order_relaxed);
+    if ((entry & KEY_MASK) != (uint64_t) mask || (entry >> KEY_BITS) == 0) {
+      return false;
+    }
+    value = (entry >> KEY_BITS) - 1;
+    return true;
+  }
+
+  void insert(long long mask, int value) {
+    slots[index(mask)].store((uint64_t) mask | (uint64_t) (value + 1) << KEY_BITS,
+                             memory_order_relaxed);
+  }
+
+ private:
+  static const uint64_t KEY_MASK = (1ULL << KEY_BITS) - 1;
+
+  size_t index(long long mask) const {
+    return ((uint64_t) mask * 0x9E3779B97F4A7C15ULL) >> shift;
+  }
+
+  int shift;
+  vector<atomic<uint64_t>> slots;
+};
+
+// LisEvaluator behind a LisCache, with the same evaluate/commit interface.
+// A hit skips the incremental evaluation. If that candidate is then
+// committed, the evaluator is brought up to date first, so only the
+// rejected hits are saved. Without a cache it is a pass-through.
+struct CachedLisEvaluator {
+  CachedLisEvaluator(LisEvaluator &inner, LisCache *cache) : inner(inner), cache(cache) {}
+
+  void reset(long long mask) {
+    stale = false;
+    inner.reset(mask);
+  }
+
+  int evaluate(long long mask) {
+    if (cache == nullptr) {
+      return inner.evaluate(mask);
+    }
+    lookups++;
+    int value;
+    if (cache->lookup(mask, value)) {
+      hits++;
+      pending = mask;
+      stale = true;
+      return value;
+    }
+    stale = false;
+    value = inner.evaluate(mask);
+    cache->insert(mask, value);
+    return value;
+  }
+
+  void commit() {
+    if (stale) {
+      inner.evaluate(pending);
+      stale = false;
+    }
+    inner.commit();
+  }
+
+  long long lookups = 0, hits = 0;
+
+ private:
+  LisEvaluator &inner;
+  LisCache *cache;
+  long long pending = 0;
+  bool stale = false;
+};
+
+// Scores LANES candidate masks at once, one candidate per 8-bit SIMD lane.
+//
+// Values are compressed to ranks 1..D. dp[v] holds, per lane, the longest
+// non-decreasing subsequence so far that ends with rank v. For each position
+// the ranks of all candidates are in one vector x; a single pass over v keeps
+// best = max(dp[1..v]) over the lanes with v <= x, and sets dp[v] = best + 1
+// in the lanes where x == v. There is no per-candidate data dependent branch
+// or load, so the lanes run independently. LIS <= 50 fits in a byte.
+struct BatchLisEvaluator {
+#ifdef __AVX2__
+  static const int LANES = 32;
+#else
+  static const int LANES = 16;  // SSE2 / NEON register width
+#endif
+  typedef int8_t Lanes __attribute__((vector_size(LANES)));
+
+  explicit BatchLisEvaluator(const vector<int> &input)
+      : n(input.size()), ranks(n), sel(n), arr(n) {
+    vector<int> values(input);
+    sort(values.begin(), values.end());
+    values.erase(unique(values.begin(), values.end()), values.end());
+    num_ranks = values.size();
+    for (int i = 0; i < n; i++) {
+      ranks[i] = 1 + (lower_bound(values.begin(), values.end(), input[i]) - values.begin());
+    }
+    dp.resize(num_ranks + 1);
+  }
+
+  // out[k] = compute_lis(reverse_subsequence(input, masks[k])), k < LANES.
+  void evaluate(const long long *masks, int *out) {
+    for (int i = 0; i < n; i++) {
+      arr[i] = Lanes{} + (int8_t) ranks[i];
+    }
+    for (int k = 0; k < LANES; k++) {
+      // Walk set bits directly; testing every bit mispredicts on random masks.
+      int m = 0;
+      for (unsigned long long rest = masks[k]; rest != 0; rest &= rest - 1) {
+        sel[m++] = __builtin_ctzll(rest);
+      }
+      for (int j = 0; j < m; j++) {
+        arr[sel[j]][k] = ranks[sel[m - 1 - j]];
+      }
+    }
+    fill(dp.begin(), dp.end(), Lanes{});
+    for (int i = 0; i < n; i++) {
+      const Lanes x = arr[i];
+      Lanes best = Lanes{};
+      for (int v = 1; v <= num_ranks; v++) {
+        Lanes le = (Lanes) (x >= (int8_t) v);
+        Lanes d = dp[v] & le;
+        best = best > d ? best : d;
+        dp[v] = x == (int8_t) v ? best + 1 : dp[v];
+      }
+    }
+    Lanes ans = Lanes{};
+    for (int v = 1; v <= num_ranks; v++) {
+      ans = ans > dp[v] ? ans : dp[v];
+    }
+    for (int k = 0; k < LANES; k++) {
+      out[k] = ans[k];
+    }
+  }
+
+ private:
+  int n, num_ranks = 0;
+  vector<int> ranks;
+  vector<int> sel;
+  vector<Lanes> arr;  // arr[i][k] = rank at position i for candidate k
+  vector<Lanes> dp;
+};
+
 int brute_solve(const vector<int> &input) {
   assert(input.size() <= 20);
   int n = input.size();
@@ -73,13 +467,171 @@ int brute_solve(const vector<int> &input) {
   return best;
 }
 
-double compute_std_deviation(const vector<int> &input, bool use_std_dev) {
+// 2^40 masks is already hours of work.
+const int GRAY_MAX_N = 40;
+
+// Exhaustive search over all 2^n masks, for use as a ground-truth oracle well
+// past brute_solve's n <= 20.
+//
+// The low CHUNK_BITS positions are fixed per chunk, and chunks are handed out
+// to threads through an atomic counter. Inside a chunk the remaining bits are
+// walked in Gray-code order, so every step flips a single bit and goes through
+// LisEvaluator::evaluate_flip: the arrangement is patched in place and the DP
+// is only redone from the first position that moved. The fast-changing Gray
+// bits map to the highest positions, which keeps that first position late.
+int gray_brute_solve(const vector<int> &input, int num_threads = 0) {
+  const int n = input.size();
+  assert(n <= GRAY_MAX_N);
+  if (n == 0) return 0;
+  if (num_threads <= 0) {
+    num_threads = max(1u, thread::hardware_concurrency());
+  }
+  const int CHUNK_BITS = min(n, 10);
+  const int walk_bits = n - CHUNK_BITS;
+  const long long num_chunks = 1LL << CHUNK_BITS;
+  atomic<long long> next_chunk(0);
+  atomic<int> best(0);
+
+  auto worker = [&]() {
+    LisEvaluator evaluator(input);
+    int local_best = 0;
+    for (long long chunk; (chunk = next_chunk.fetch_add(1)) < num_chunks;) {
+      evaluator.reset(chunk);
+      local_best = max(local_best, evaluator.value());
+      for (long long k = 1; k < (1LL << walk_bits); k++) {
+        int bit = n - 1 - __builtin_ctzll(k);
+        local_best = max(local_best, evaluator.evaluate_flip(bit));
+        evaluator.commit();
+      }
+    }
+    int seen = best.load();
+    while (local_best > seen && !best.compare_exchange_weak(seen, local_best)) {
+    }
+  };
+
+  vector<thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back(worker);
+  }
+  for (thread &th : threads) {
+    th.join();
+  }
+  return best.load();
+}
+
+// Whether exact_solve applies: any values, but at most EXACT_MAX_N elements,
+// so lengths fit its uint8 cells and n * D * D its int layer size.
+const int EXACT_MAX_N = 255;
+
+bool fits_exact_solver(const vector<int> &input) {
+  return input.size() <= (size_t) EXACT_MAX_N;
+}
+
+// Exact solver, O(n^2 * D^2) for D distinct values.
+//
+// best(l, r, lo, hi) is the longest non-decreasing subsequence of a[l..r] that
+// only uses values in [lo, hi], when a subsequence of a[l..r] may be reversed.
+// A reversal swaps its outermost pair first, so either a[l] or a[r] stays in
+// place (peel it off, counting it if it equals lo or hi respectively), or a[l]
+// and a[r] swap with each other, or the value range shrinks by one.
+//
+// Values are compressed to ranks, and only interval lengths len - 1 and
+// len - 2 are needed, so the state is three rolling layers of n * D * D bytes.
+// Within a layer hi is innermost, so every transition streams over a
+// contiguous row.
+int exact_solve(const vector<int> &input) {
+  assert(fits_exact_solver(input));
+  int n = input.size();
+  if (n == 0) return 0;
+  vector<int> values(input);
+  sort(values.begin(), values.end());
+  values.erase(unique(values.begin(), values.end()), values.end());
+  const int D = values.size();
+  vector<int> a(n);
+  for (int i = 0; i < n; i++) {
+    a[i] = lower_bound(values.begin(), values.end(), input[i]) - values.begin();
+  }
+
+  const int layer_size = n * D * D;
+  // layer[len % 3][(l * D + lo) * D + hi]
+  vector<uint8_t> layers(3 * layer_size, 0);
+  auto cell = [&](int len, int l, int lo) {
+    return &layers[(len % 3) * layer_size + (l * D + lo) * D];
+  };
+  vector<uint8_t> row(D);
+
+  for (int l = 0; l < n; l++) {
+    for (int lo = 0; lo < D; lo++) {
+      uint8_t *cur = cell(1, l, lo);
+      for (int hi = lo; hi < D; hi++) {
+        cur[hi] = lo <= a[l] && a[l] <= hi;
+      }
+    }
+  }
+  for (int len = 2; len <= n; len++) {
+    for (int l = 0; l + len <= n; l++) {
+      const int r = l + len - 1;
+      for (int lo = D - 1; lo >= 0; lo--) {
+        const uint8_t *skip_l = cell(len - 1, l + 1, lo);
+        const uint8_t *skip_r = cell(len - 1, l, lo);
+        const uint8_t *swapped = cell(len - 2, l + 1, lo);
+        uint8_t *cur = cell(len, l, lo);
+        for (int hi = lo; hi < D; hi++) {
+          uint8_t best = max(skip_l[hi] + (a[l] == lo), skip_r[hi] + (a[r] == hi));
+          best = max<uint8_t>(best, swapped[hi] + (a[l] == hi) + (a[r] == lo));
+          row[hi] = best;
+        }
+        if (lo + 1 < D) {
+          // Shrink the range from below: best(l, r, lo + 1, hi).
+          const uint8_t *above = cell(len, l, lo + 1);
+          for (int hi = lo + 1; hi < D; hi++) {
+            row[hi] = max(row[hi], above[hi]);
+          }
+        }
+        // Shrink the range from above: best(l, r, lo, hi - 1).
+        cur[lo] = row[lo];
+        for (int hi = lo + 1; hi < D; hi++) {
+          cur[hi] = max(row[hi], cur[hi - 1]);
+        }
+      }
+    }
+  }
+  return cell(n, 0, 0)[D - 1];
+}
+
+// Whether the mask-based solvers apply: at most 50 elements (a long long
+// mask, uint8 DP rows) with values in 1..50, as in the original problem.
+bool fits_mask_solvers(const vector<int> &input) {
+  if (input.size() > (size_t) LisEvaluator::MAXV) return false;
+  for (int x : input) {
+    if (x < 1 || x > LisEvaluator::MAXV) return false;
+  }
+  return true;
+}
+
+double compute_std_deviation(const vector<int> &input, bool use_std_dev, Rng &rng) {
   int n = input.size();
-  const long long modulo = (1LL << n);
   vector<int> costs;
-  for (int iter = 0; iter < 1000; iter++) {
-    long long state = distrib(gen) % modulo;
-    costs.push_back(compute_lis(reverse_subsequence(input, state)));
+  if (fits_mask_solvers(input)) {
+    const long long modulo = (1LL << n);
+    LisEvaluator evaluator(input);
+    for (int iter = 0; iter < 1000; iter++) {
+      long long state = rng.next() & (modulo - 1);
+      costs.push_back(evaluator.evaluate(state));
+    }
+  } else {
+    // Each sample costs O(n log n); keep the estimate to a few 10^6 steps.
+    const int samples = max(30, min(1000, 5000000 / max(n, 1)));
+    PatienceEvaluator evaluator(input);
+    for (int iter = 0; iter < samples; iter++) {
+      DynamicBitset state(n);
+      for (int i = 0; i < n; i++) {
+        if (rng.next() & 1) {
+          state.flip(i);
+        }
+      }
+      costs.push_back(evaluator.evaluate(state));
+    }
   }
   // Compute mean
   double sum = 0.0;
@@ -107,7 +659,8 @@ int simulated_annealing_solve_bad(const vector<int> &input) {
   int n = input.size();
   const long long FULL = (1LL << n) - 1;
   const int BATCH = 10;
-  const double T0 = compute_std_deviation(input, true);
+  Rng rng(rd());
+  const double T0 = compute_std_deviation(input, true, rng);
   const double COOLING = 0.99;
   auto acceptance = [&](double c_old, double c_new, const double t) -> double {
     if (c_old < c_new) {
@@ -115,19 +668,19 @@ int simulated_annealing_solve_bad(const vector<int> &input) {
     }
     return std::exp((c_new - c_old) / t);
   };
-  long long state = distrib(gen) % (1LL << n);
+  long long state = rng.next() & FULL;
   vector<int> tmp = reverse_subsequence(input, state);
   int best = compute_lis(input);
   int c_old = compute_lis(tmp);
   while (clock() / (double) CLOCKS_PER_SEC <= 1.95) {
     double t = T0;
     for (int b = 0; b < BATCH; b++) {
-      int bit_to_flip = (distrib(gen) % n);
+      int bit_to_flip = rng.bounded(n);
       long long neighbor = (1LL << bit_to_flip) ^ state;
       vector<int> tmp2 = reverse_subsequence(input, neighbor);
       int c_new = compute_lis(tmp2);
       best = max(best, max(c_old, c_new));
-      if (acceptance(c_old, c_new, t) >= dbl_distrib(gen)) {
+      if (acceptance(c_old, c_new, t) >= rng.uniform()) {
         tmp = tmp2;
         state = neighbor;
         c_old = c_new;
@@ -138,71 +691,586 @@ int simulated_annealing_solve_bad(const vector<int> &input) {
   return best;
 }
 
-int simulated_annealing_solve(const vector<int> &input) {
+// Move policy for anneal(): XOR a random set of bits into the mask. Hot
+// moves flip about n * T / T0 bits; once that reaches zero, min(5, n / 2).
+struct MaskFlips {
+  typedef long long Move;
+
+  int n;
+  double t0;
+  Rng &rng;
+
+  void propose(long long, double temperature, long long &move) {
+    int max_iters = min(max((int) (n * (temperature / t0)), 0), n);
+    if (max_iters == 0) {
+      max_iters = min(5, n / 2);
+    }
+    uint32_t bits[64];
+    rng.fill_bounded(n, bits, max_iters);
+    move = 0;
+    for (int idx = 0; idx < max_iters; idx++) {
+      move ^= 1LL << bits[idx];
+    }
+  }
+  void apply(long long &state, long long move) { state ^= move; }
+  void undo(long long &state, long long move) { state ^= move; }
+};
+
+// Move policy for anneal() on a DynamicBitset. Same shape as MaskFlips, but
+// at most MAX_FLIPS bits per move however long the input is.
+struct BitsetFlips {
+  typedef vector<uint32_t> Move;
+  static constexpr int MAX_FLIPS = 64;
+
+  int n;
+  double t0;
+  Rng &rng;
+
+  void propose(const DynamicBitset &, double temperature, vector<uint32_t> &move) {
+    int flips = max(1, (int) (min(n, MAX_FLIPS) * (temperature / t0)));
+    move.resize(flips);
+    rng.fill_bounded(n, move.data(), flips);
+  }
+  void apply(DynamicBitset &state, const vector<uint32_t> &move) {
+    for (uint32_t i : move) {
+      state.flip(i);
+    }
+  }
+  void undo(DynamicBitset &state, const vector<uint32_t> &move) { apply(state, move); }
+};
+
+// Annealing for instances the mask solvers cannot take: long inputs (10^4 to
+// 10^5 elements) or values outside 1..50. Each evaluation is O(n log n), so
+// a run is thousands of steps rather than millions. It therefore starts from
+// the input itself (the empty set) instead of a random half reversed, and
+// cools faster per step.
+int bitset_annealing_solve(const vector<int> &input,
+                           const SolveOptions &opts = SolveOptions()) {
+  SolveControl control(opts, input);
+  const int n = input.size();
+  if (n == 0) return control.finish();
+  if (n > 1000) {
+    // Evaluations take long enough to overrun the deadline between polls.
+    control.poll_every_eval();
+  }
+  Rng rng(opts.seed != 0 ? opts.seed : rd());
+  const double T0 = max(compute_std_deviation(input, true, rng), 0.1);
+  const double COOLING = 0.999;
+  DynamicBitset state(n);
+  PatienceEvaluator evaluator(input);
+  int score = evaluator.evaluate(state);
+  control.improve(score);
+  BitsetFlips moves{n, T0, rng};
+  GeometricCooling schedule{T0, COOLING};
+  anneal(state, score, moves, evaluator, schedule, [&] { return rng.uniform(); }, control);
+  return control.finish();
+}
+
+// The run behind simulated_annealing_solve, with the evaluator left open: any
+// anneal() Evaluator over long long masks. Starts from a random mask.
+template <class Evaluator>
+void anneal_masks(const vector<int> &input, SolveControl &control, Rng &rng,
+                  Evaluator &evaluator) {
   int n = input.size();
-  const double T0 = compute_std_deviation(input, true);
+  if (n == 0) return;
+  const double T0 = max(compute_std_deviation(input, true, rng), 0.1);
   const double COOLING = 0.9999;
-  auto acceptance = [&](double c_old, double c_new, const double t) -> double {
-    if (c_old < c_new) {
-      return 1.0;
-    }
-    return std::exp((c_new - c_old) / t);
-  };
-  int best = compute_lis(input);
+  control.improve(compute_lis(input));
   // Initialize random state.
-  long long state = 0;
-  for (int idx = 0; idx < n; idx++) {
-    if ((distrib(gen) & 1LL) > 0) {
-      state ^= (1LL << idx);
-    }
+  long long state = rng.next() & ((1LL << n) - 1);
+  int c_old = evaluator.evaluate(state);
+  evaluator.commit();
+  control.improve(c_old);
+  MaskFlips moves{n, T0, rng};
+  // The first step already runs one cooling step below T0.
+  GeometricCooling schedule{T0 * COOLING, COOLING};
+  anneal(state, c_old, moves, evaluator, schedule, [&] { return rng.uniform(); }, control);
+}
+
+int simulated_annealing_solve(const vector<int> &input,
+                              const SolveOptions &opts = SolveOptions()) {
+  if (!fits_mask_solvers(input)) {
+    return bitset_annealing_solve(input, opts);
+  }
+  SolveControl control(opts, input);
+  Rng rng(opts.seed != 0 ? opts.seed : rd());
+  LisEvaluator lis(input);
+  unique_ptr<LisCache> cache;
+  if (opts.cache_log_size > 0) {
+    cache.reset(new LisCache(opts.cache_log_size));
+  }
+  CachedLisEvaluator evaluator(lis, cache.get());
+  anneal_masks(input, control, rng, evaluator);
+  control.add_cache_stats(evaluator.lookups, evaluator.hits);
+  return control.finish();
+}
+
+#ifdef SUBREV_JIT
+// simulated_annealing_solve with a JitLisEvaluator compiled for this input.
+// The compile counts against the time limit. Falls back to the generic
+// evaluator if LLVM fails.
+int jit_annealing_solve(const vector<int> &input,
+                        const SolveOptions &opts = SolveOptions()) {
+  if (!fits_mask_solvers(input)) {
+    return bitset_annealing_solve(input, opts);
+  }
+  SolveControl control(opts, input);
+  JitLisEvaluator evaluator(input);
+  if (!evaluator.ok()) {
+    cerr << "JIT compile failed, using the generic evaluator" << endl;
+    return simulated_annealing_solve(input, opts);
   }
+  Rng rng(opts.seed != 0 ? opts.seed : rd());
+  anneal_masks(input, control, rng, evaluator);
+  return control.finish();
+}
+#endif  // SUBREV_JIT
+
+// simulated_annealing_solve, but every step proposes LANES neighbours of the
+// current state, scores them together with BatchLisEvaluator and runs the
+// Metropolis test on the best one. The temperature drops by COOLING per
+// evaluation as before, so the schedule in terms of evaluations is unchanged.
+int batch_annealing_solve(const vector<int> &input,
+                          const SolveOptions &opts = SolveOptions()) {
+  const int LANES = BatchLisEvaluator::LANES;
+  SolveControl control(opts, input);
+  Rng rng(opts.seed != 0 ? opts.seed : rd());
+  int n = input.size();
+  if (n == 0) return control.finish();
+  const double T0 = max(compute_std_deviation(input, true, rng), 0.1);
+  const double COOLING = pow(0.9999, LANES);
+  control.improve(compute_lis(input));
+  long long state = rng.next() & ((1LL << n) - 1);
   double temperature = T0;
-  vector<int> tmp = reverse_subsequence(input, state);
-  int batch = 1;
-  int c_old = compute_lis(tmp);
-  int num_eval = 0;
-  while (clock() / (double) CLOCKS_PER_SEC <= 1.95) {
-    num_eval++;
-    if (num_eval % batch == 0) {
-      temperature *= COOLING;
-    }
-    long long new_state = state;
-    int max_iters = n * (temperature / T0);
+  BatchLisEvaluator evaluator(input);
+  long long masks[LANES];
+  int costs[LANES];
+  vector<uint32_t> bits(LANES * max(n, 1));
+  int c_old = compute_lis(reverse_subsequence(input, state));
+  control.improve(c_old);
+  long long num_eval = 0;
+  while (!control.should_stop(num_eval)) {
+    num_eval += LANES;
+    temperature *= COOLING;
+    int max_iters = min(max((int) (n * (temperature / T0)), 0), n);
     if (max_iters == 0) {
       max_iters = min(5, n / 2);
     }
-    for (int idx = 0; idx < max_iters; idx++) {
-      long long bb = 1LL << (distrib(gen) % n);
-      new_state ^= (bb);
-    }
-    vector<int> tmp2 = reverse_subsequence(input, new_state);
-    int c_new = compute_lis(tmp2);
-    best = max(best, max(c_old, c_new));
-    int x = 1 + rand();
-    int y = 1 + rand();
-    x %= y;
-    // cerr << dbl_distrib(gen) << " " << (x / (double) y) << endl;
-    if (acceptance(c_old, c_new, temperature) >= x / (double) y) {
-      state = new_state;
-      tmp = tmp2;
+    // All LANES * max_iters bit positions in one draw.
+    rng.fill_bounded(n, bits.data(), LANES * max_iters);
+    for (int k = 0; k < LANES; k++) {
+      masks[k] = state;
+      for (int idx = 0; idx < max_iters; idx++) {
+        masks[k] ^= 1LL << bits[k * max_iters + idx];
+      }
+    }
+    evaluator.evaluate(masks, costs);
+    int pick = max_element(costs, costs + LANES) - costs;
+    int c_new = costs[pick];
+    control.improve(c_new);
+    if (c_new >= c_old || exp((c_new - c_old) / temperature) >= rng.uniform()) {
+      state = masks[pick];
       c_old = c_new;
     }
   }
-  return best;
+  control.add_evals(num_eval);
+  return control.finish();
 }
 
-int main() {
+// Parallel tempering: one annealing replica per hardware thread, each at a
+// fixed temperature from a geometric ladder between T0 and T_MIN.
+//
+// Every EXCHANGE_INTERVAL evaluations a replica either picks up a state that a
+// neighbour swapped into its slot, or publishes its current state there. On
+// alternating epochs, even/odd replicas then offer a swap to the next hotter
+// one with the usual probability min(1, exp((c_j - c_i) * (1/T_i - 1/T_j))).
+// Swaps only touch the two slots under their locks; the hotter replica adopts
+// its new state at its next exchange point.
+//
+// Each replica has its own Rng stream. All replicas share one SolveControl, so the first to reach
+// the upper bound stops the others.
+int parallel_tempering_solve(const vector<int> &input,
+                             const SolveOptions &opts = SolveOptions(),
+                             int num_replicas = 0) {
+  const int n = input.size();
+  if (n == 0) return 0;
+  if (num_replicas <= 0) {
+    // Fewer than four rungs leaves gaps too wide for swaps to be accepted.
+    num_replicas = max(4u, thread::hardware_concurrency());
+  }
+  const int EXCHANGE_INTERVAL = 256;
+  const uint64_t base_seed = opts.seed != 0 ? opts.seed : rd();
+  Rng ladder_rng(base_seed, num_replicas);
+  const double T0 = max(compute_std_deviation(input, true, ladder_rng), 0.1);
+  // With an evaluation cap every replica gets an equal share of it.
+  SolveOptions replica_opts = opts;
+  if (opts.max_evals >= 0) {
+    replica_opts.max_evals = opts.max_evals / num_replicas;
+  }
+  SolveControl control(replica_opts, input);
+  const double T_MIN = 0.05;
+  vector<double> temps(num_replicas);
+  for (int r = 0; r < num_replicas; r++) {
+    double frac = num_replicas == 1 ? 0.0 : r / (double) (num_replicas - 1);
+    temps[r] = T_MIN * pow(T0 / T_MIN, frac);  // temps[0] is the coldest
+  }
+
+  struct Slot {
+    mutex m;
+    long long state = 0;
+    int cost = 0;
+    bool incoming = false;
+  };
+  vector<Slot> slots(num_replicas);
+  // One cache shared by all replicas.
+  unique_ptr<LisCache> cache;
+  if (opts.cache_log_size > 0) {
+    cache.reset(new LisCache(opts.cache_log_size));
+  }
+  control.improve(compute_lis(input));
+
+  auto replica = [&](int r) {
+    Rng rng(base_seed, r);
+    const double t = temps[r];
+    int flips = n * (t / T0);
+    if (flips == 0) {
+      flips = max(1, min(5, n / 2));
+    }
+
+    long long state = rng.next() & ((1LL << n) - 1);
+    LisEvaluator lis(input);
+    CachedLisEvaluator evaluator(lis, cache.get());
+    evaluator.reset(state);
+    int cost = lis.value();
+    {
+      lock_guard<mutex> lock(slots[r].m);
+      slots[r].state = state;
+      slots[r].cost = cost;
+    }
+    control.improve(cost);
+
+    uint32_t bits[64];
+    for (long long step = 1;; step++) {
+      long long new_state = state;
+      rng.fill_bounded(n, bits, flips);
+      for (int k = 0; k < flips; k++) {
+        new_state ^= 1LL << bits[k];
+      }
+      int c_new = evaluator.evaluate(new_state);
+      if (c_new >= cost || exp((c_new - cost) / t) >= rng.uniform()) {
+        if (c_new > cost) {
+          control.improve(c_new);
+        }
+        state = new_state;
+        cost = c_new;
+        evaluator.commit();
+      }
+      if (control.should_stop(step)) {
+        control.add_evals(step);
+        control.add_cache_stats(evaluator.lookups, evaluator.hits);
+        break;
+      }
+      if (step % EXCHANGE_INTERVAL != 0) {
+        continue;
+      }
+      {
+        lock_guard<mutex> lock(slots[r].m);
+        if (slots[r].incoming) {
+          slots[r].incoming = false;
+          state = slots[r].state;
+          cost = slots[r].cost;
+          evaluator.reset(state);
+        } else {
+          slots[r].state = state;
+          slots[r].cost = cost;
+        }
+      }
+      long long epoch = step / EXCHANGE_INTERVAL;
+      if (r + 1 < num_replicas && (r + epoch) % 2 == 0) {
+        scoped_lock lock(slots[r].m, slots[r + 1].m);
+        Slot &mine = slots[r], &hot = slots[r + 1];
+        if (mine.incoming || hot.incoming) {
+          continue;
+        }
+        double p = exp((hot.cost - mine.cost) * (1.0 / t - 1.0 / temps[r + 1]));
+        if (p >= 1.0 || p >= rng.uniform()) {
+          swap(mine.state, hot.state);
+          swap(mine.cost, hot.cost);
+          hot.incoming = true;
+          state = mine.state;
+          cost = mine.cost;
+          evaluator.reset(state);
+        }
+      }
+    }
+  };
+
+  vector<thread> threads;
+  for (int r = 0; r < num_replicas; r++) {
+    threads.emplace_back(replica, r);
+  }
+  for (thread &th : threads) {
+    th.join();
+  }
+  return control.finish();
+}
+
+bool read_instance(istream &in, vector<int> &arr) {
+  int n;
+  if (!(in >> n)) return false;
+  arr.resize(n);
+  for (int i = 0; i < n; i++) {
+    in >> arr[i];
+  }
+  return bool(in);
+}
+
+// Runs the exact solver on each file and compares the heuristics against it.
+// Returns non-zero if anything disagrees with the exact answer in a way a
+// heuristic cannot (brute force differing, or an annealer beating it).
+int cross_check(int num_files, char **files) {
+  int failures = 0;
+  for (int f = 0; f < num_files; f++) {
+    ifstream in(files[f]);
+    vector<int> arr;
+    if (!read_instance(in, arr)) {
+      cerr << files[f] << ": cannot read instance" << endl;
+      failures++;
+      continue;
+    }
+    if (!fits_exact_solver(arr)) {
+      cout << files[f] << ": n=" << arr.size() << " bound=" << lis_upper_bound(arr)
+           << " anneal=" << bitset_annealing_solve(arr) << endl;
+      continue;
+    }
+    int exact = exact_solve(arr);
+    int bound = lis_upper_bound(arr);
+    cout << files[f] << ": n=" << arr.size() << " exact=" << exact
+         << " bound=" << bound;
+    failures += exact > bound;
+    if (!fits_mask_solvers(arr)) {
+      int anneal = bitset_annealing_solve(arr);
+      cout << " anneal=" << anneal
+           << (anneal == exact ? " ok" : anneal < exact ? " miss" : " WRONG") << endl;
+      failures += anneal > exact;
+      continue;
+    }
+    if (arr.size() <= 20) {
+      int brute = brute_solve(arr);
+      cout << " brute=" << brute;
+      failures += brute != exact;
+    }
+    if (arr.size() <= 24) {
+      int gray = gray_brute_solve(arr);
+      cout << " gray=" << gray;
+      failures += gray != exact;
+    }
+    auto report = [&](const char *name, int got) {
+      cout << " " << name << "=" << got
+           << (got == exact ? " ok" : got < exact ? " miss" : " WRONG");
+      failures += got > exact;
+    };
+    // With the exact answer as the bound the annealers stop once they find it;
+    // a value above it is still returned and reported.
+    SolveOptions opts;
+    opts.upper_bound = exact;
+    report("anneal", simulated_annealing_solve(arr, opts));
+    report("batch", batch_annealing_solve(arr, opts));
+    report("parallel", parallel_tempering_solve(arr, opts));
+    cout << endl;
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+// Appends every instance in `in` (concatenated, each one "n a_1 .. a_n") to
+// `out`. Returns false if something other than whitespace is left over.
+bool read_instances(istream &in, vector<vector<int>> &out) {
+  vector<int> arr;
+  while (read_instance(in, arr)) {
+    out.push_back(arr);
+  }
+  return in.eof();
+}
+
+// Solves many independent instances on a pool of worker threads. Instances
+// come from stdin, or from the files given (every *.txt file, by name, for a
+// directory), each holding one or more concatenated instances. Every instance
+// is owed `--budget` seconds; a run that stops early, proven optimal or
+// `--stall` seconds without improving, banks the rest. Each instance started
+// later draws an even share of the bank on top of its own budget. Answers
+// go to stdout one per line in input order, each as soon as every earlier
+// one is known.
+int solve_stream(int num_args, char **args) {
+  double budget = 1.95, stall = 0.25;
+  int num_threads = thread::hardware_concurrency();
+  uint64_t seed = 0;
+  vector<string> paths;
+  for (int a = 0; a < num_args; a++) {
+    string arg = args[a];
+    if (arg.rfind("--budget=", 0) == 0) {
+      budget = stod(arg.substr(9));
+    } else if (arg.rfind("--stall=", 0) == 0) {
+      stall = stod(arg.substr(8));
+    } else if (arg.rfind("--threads=", 0) == 0) {
+      num_threads = stoi(arg.substr(10));
+    } else if (arg.rfind("--seed=", 0) == 0) {
+      seed = stoull(arg.substr(7));
+    } else if (filesystem::is_directory(arg)) {
+      vector<string> files;
+      for (const auto &entry : filesystem::directory_iterator(arg)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") {
+          files.push_back(entry.path().string());
+        }
+      }
+      sort(files.begin(), files.end());
+      paths.insert(paths.end(), files.begin(), files.end());
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  num_threads = max(num_threads, 1);
+
+  vector<vector<int>> instances;
+  bool read_ok = true;
+  if (paths.empty()) {
+    read_ok = read_instances(cin, instances);
+  }
+  for (const string &path : paths) {
+    ifstream in(path);
+    if (!read_instances(in, instances)) {
+      cerr << path << ": cannot read instance" << endl;
+      read_ok = false;
+    }
+  }
+  const int count = instances.size();
+
+  Stopwatch watch;
+  mutex bank_mutex, out_mutex;
+  double bank = 0;       // seconds left over by finished instances
+  int started = 0;       // under bank_mutex
+  int proven = 0;        // under out_mutex
+  int next_to_print = 0;
+  vector<int> answers(count, -1);
+  atomic<int> next_instance{0};
+
+  auto worker = [&] {
+    for (int i; (i = next_instance.fetch_add(1)) < count;) {
+      double grant = budget;
+      {
+        lock_guard<mutex> lock(bank_mutex);
+        // Instances already running cannot take more time, so the bank is
+        // split over the ones yet to start, or at least one per thread.
+        const double share = bank / max(count - started, num_threads);
+        started++;
+        bank -= share;
+        grant += share;
+      }
+      SolveStats stats;
+      SolveOptions opts;
+      opts.time_limit = grant;
+      opts.stall_limit = stall;
+      opts.seed = seed != 0 ? seed + i : 0;
+      opts.stats = &stats;
+      const int answer = simulated_annealing_solve(instances[i], opts);
+      {
+        lock_guard<mutex> lock(bank_mutex);
+        bank += max(grant - stats.seconds, 0.0);
+      }
+      lock_guard<mutex> lock(out_mutex);
+      answers[i] = answer;
+      proven += stats.proven_optimal;
+      for (; next_to_print < count && answers[next_to_print] >= 0; next_to_print++) {
+        cout << answers[next_to_print] << '\n';
+      }
+      cout.flush();
+    }
+  };
+  vector<thread> threads;
+  for (int t = 0; t < min(num_threads, count); t++) {
+    threads.emplace_back(worker);
+  }
+  for (thread &th : threads) {
+    th.join();
+  }
+  cerr << count << " instances on " << min(num_threads, count) << " threads in "
+       << watch.elapsed() << "s, " << proven << " proven optimal, " << bank
+       << "s of budget unused" << endl;
+  return read_ok ? 0 : 1;
+}
+
+// Usage (build with -pthread):
+//   ./subseq_reversal < in            simulated annealing (default); inputs
+//                                     beyond n = 50 or values 1..50 use
+//                                     bitset_annealing_solve
+//   ./subseq_reversal exact < in      exact interval DP, n <= 255, any values
+//   ./subseq_reversal gray < in       exhaustive Gray-code search, n <= 40
+//   ./subseq_reversal batch < in      annealing with SIMD batches of neighbours
+//   ./subseq_reversal parallel < in   parallel tempering on every core
+//   ./subseq_reversal jit < in        annealing with a JIT-compiled evaluator
+//                                     (build with -DSUBREV_JIT, see lis_jit.h)
+//   ./subseq_reversal check *.txt     exact vs. exhaustive vs. heuristics
+//   ./subseq_reversal stream [--budget=S] [--stall=S] [--threads=K]
+//                            [--seed=S] [file|dir ...] < in
+//                                     many instances across all cores, see
+//                                     solve_stream
+//
+// --telemetry=out.csv (anneal and jit modes only) writes samples of the
+// temperature, acceptance ratio, costs and evals/sec to out.csv when the run
+// ends.
+#ifndef SUBREV_NO_MAIN
+int main(int argc, char **argv) {
   ios_base::sync_with_stdio(false);
   // freopen("subrev.in", "r", stdin);
   // freopen("subrev.out", "w", stdout);
-  init();
-  int n;
-  cin >> n;
-  vector<int> arr(n);
-  for (int i = 0; i < n; i++) {
-    cin >> arr[i];
+  string mode = "anneal", telemetry_path;
+  if (argc > 1 && string(argv[1]).rfind("--telemetry=", 0) == 0) {
+    telemetry_path = argv[1] + 12;
+  } else if (argc > 1) {
+    mode = argv[1];
+    if (argc > 2 && string(argv[2]).rfind("--telemetry=", 0) == 0) {
+      telemetry_path = argv[2] + 12;
+    }
   }
-  int answer = simulated_annealing_solve(arr);
+  if (!telemetry_path.empty() && mode != "anneal" && mode != "jit") {
+    cerr << "--telemetry only applies to anneal and jit" << endl;
+    return 1;
+  }
+  if (mode == "check") {
+    return cross_check(argc - 2, argv + 2);
+  }
+  if (mode == "stream") {
+    return solve_stream(argc - 2, argv + 2);
+  }
+  vector<int> arr;
+  read_instance(cin, arr);
+  if (mode == "exact" && !fits_exact_solver(arr)) {
+    cerr << "n > " << EXACT_MAX_N << ": exact does not apply, using anneal" << endl;
+    mode = "anneal";
+  } else if (mode != "exact" && mode != "anneal" && !fits_mask_solvers(arr)) {
+    cerr << "n > 50 or values outside 1..50: only exact and anneal apply" << endl;
+    mode = "anneal";
+  } else if (mode == "gray" && arr.size() > (size_t) GRAY_MAX_N) {
+    cerr << "n > " << GRAY_MAX_N << ": gray does not apply, using anneal" << endl;
+    mode = "anneal";
+  }
+  // The bitset annealer manages only thousands of evaluations per run.
+  Telemetry telemetry(4096, fits_mask_solvers(arr) ? 4096 : 16);
+  SolveOptions opts;
+  if (!telemetry_path.empty()) {
+    opts.telemetry = &telemetry;
+  }
+  int answer = mode == "exact"      ? exact_solve(arr)
+               : mode == "gray"     ? gray_brute_solve(arr)
+               : mode == "batch"    ? batch_annealing_solve(arr)
+               : mode == "parallel" ? parallel_tempering_solve(arr)
+#ifdef SUBREV_JIT
+               : mode == "jit"      ? jit_annealing_solve(arr, opts)
+#endif
+                                    : simulated_annealing_solve(arr, opts);
   cout << answer << endl;
+  if (!telemetry_path.empty() && !telemetry.write_csv(telemetry_path)) {
+    cerr << telemetry_path << ": cannot write telemetry" << endl;
+  }
   return 0;
-}
\ No newline at end of file
+}
+#endif  // SUBREV_NO_MAIN
@@ -0,0 +1,90 @@
+// Sampled trace of an annealing run, for tuning T0, the cooling rate and the
+// move size from data. anneal() records a sample every `interval`
+// evaluations into a ring buffer allocated up front, so the hot loop pays one
+// mask test per step and never allocates. Dump it with write_csv() once the
+// run is over.
+#ifndef SUBREV_TELEMETRY_H
+#define SUBREV_TELEMETRY_H
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "solver.h"
+
+struct TelemetrySample {
+  double seconds;        // since the Telemetry was created
+  long long evals;
+  double temperature;
+  double acceptance;     // accepted / proposed since the previous sample
+  int current;
+  int best;
+  double evals_per_sec;  // since the previous sample
+};
+
+class Telemetry {
+ public:
+  // Keeps the last `capacity` samples. `interval` is rounded up to a power of
+  // two so due() is a single AND.
+  explicit Telemetry(size_t capacity = 4096, long long interval = 4096)
+      : samples_(capacity > 0 ? capacity : 1) {
+    long long step = 1;
+    while (step < interval) step <<= 1;
+    mask_ = step - 1;
+  }
+
+  bool due(long long evals) const { return (evals & mask_) == 0; }
+
+  // `accepted` is the running count of accepted moves.
+  void record(long long evals, double temperature, long long accepted, int current,
+              int best) {
+    const double now = watch_.elapsed();
+    const long long proposed = evals - last_evals_;
+    TelemetrySample &s = samples_[next_];
+    s.seconds = now;
+    s.evals = evals;
+    s.temperature = temperature;
+    s.acceptance = proposed > 0 ? (accepted - last_accepted_) / (double) proposed : 0;
+    s.current = current;
+    s.best = best;
+    s.evals_per_sec = now > last_seconds_ ? proposed / (now - last_seconds_) : 0;
+    next_ = (next_ + 1) % samples_.size();
+    count_ = std::min(count_ + 1, samples_.size());
+    last_evals_ = evals;
+    last_accepted_ = accepted;
+    last_seconds_ = now;
+  }
+
+  size_t size() const { return count_; }
+
+  // Oldest first.
+  void write_csv(std::ostream &out) const {
+    out << "seconds,evals,temperature,acceptance,current,best,evals_per_sec\n";
+    const size_t first = (next_ + samples_.size() - count_) % samples_.size();
+    for (size_t k = 0; k < count_; k++) {
+      const TelemetrySample &s = samples_[(first + k) % samples_.size()];
+      out << s.seconds << ',' << s.evals << ',' << s.temperature << ','
+          << s.acceptance << ',' << s.current << ',' << s.best << ','
+          << s.evals_per_sec << '\n';
+    }
+  }
+
+  bool write_csv(const std::string &path) const {
+    std::ofstream out(path);
+    write_csv(out);
+    return bool(out);
+  }
+
+ private:
+  std::vector<TelemetrySample> samples_;
+  long long mask_;
+  size_t next_ = 0;
+  size_t count_ = 0;
+  Stopwatch watch_;
+  long long last_evals_ = 0;
+  long long last_accepted_ = 0;
+  double last_seconds_ = 0;
+};
+
+#endif  // SUBREV_TELEMETRY_H
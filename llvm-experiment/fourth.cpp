@@ -8,11 +8,22 @@
 // Run:
 //   ./jit_gte_optimized
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <string>
 #include <vector>
 #include <ctime>
 
+#include <sys/mman.h>
+
 #include "llvm/ADT/APInt.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/IR/BasicBlock.h"
@@ -33,23 +44,84 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/raw_ostream.h"
+#if LLVM_VERSION_MAJOR >= 17
+#include "llvm/TargetParser/Host.h"
+#else
+#include "llvm/Support/Host.h"
+#endif
 
 using namespace llvm;
 using namespace llvm::orc;
 
+// ---------- Per-kernel code generation knobs ----------
+// These are what the tuner (see tuneRunGte) searches over; the winner is
+// cached per signature and CPU. With vectorWidth == 0 the kernel is the plain
+// scalar loop and the O3 vectorizer picks the shape, with interleave/unroll
+// passed along as loop hints. With vectorWidth != 0 the vector loop is
+// emitted directly, because the loop vectorizer refuses loops containing a
+// prefetch call or a nontemporal store.
+struct KernelConfig {
+  unsigned vectorWidth = 0;        // lanes per vector, 0 = vectorizer's choice
+  unsigned interleave = 0;         // vectors per iteration (hint when scalar)
+  unsigned unroll = 0;
+  unsigned prefetchDistance = 0;   // rows ahead, explicit vector loop only
+  bool streamingStores = false;    // !nontemporal, explicit vector loop only
+
+  std::string str() const {
+    return "width=" + std::to_string(vectorWidth) +
+           " interleave=" + std::to_string(interleave) +
+           " unroll=" + std::to_string(unroll) +
+           " prefetch=" + std::to_string(prefetchDistance) +
+           " streaming=" + std::to_string(streamingStores);
+  }
+
+  static bool parse(const std::string& text, KernelConfig& cfg) {
+    unsigned streaming = 0;
+    if (sscanf(text.c_str(), "width=%u interleave=%u unroll=%u prefetch=%u streaming=%u",
+               &cfg.vectorWidth, &cfg.interleave, &cfg.unroll,
+               &cfg.prefetchDistance, &streaming) != 5) {
+      return false;
+    }
+    cfg.streamingStores = streaming != 0;
+    return true;
+  }
+};
+
+// Attach an llvm.loop ID carrying `hints` to the loop latch branch.
+static void setLoopHints(Instruction* latch, LLVMContext& C,
+                         ArrayRef<std::pair<const char*, unsigned>> hints) {
+  if (hints.empty()) {
+    return;
+  }
+  Type* I32 = Type::getInt32Ty(C);
+  SmallVector<Metadata*, 4> ops;
+  ops.push_back(nullptr);  // self reference, patched below
+  for (const auto& hint : hints) {
+    ops.push_back(MDNode::get(C, { MDString::get(C, hint.first),
+                                   ConstantAsMetadata::get(
+                                       ConstantInt::get(I32, hint.second)) }));
+  }
+  MDNode* loopID = MDNode::getDistinct(C, ops);
+  loopID->replaceOperandWith(0, loopID);
+  latch->setMetadata(LLVMContext::MD_loop, loopID);
+}
+
 // ---------- IR Builder for run_gte_comparison ----------
-static Function* buildRunGte(Module& M, LLVMContext& C) {
+static Function* buildRunGte(Module& M, LLVMContext& C,
+                             const KernelConfig& cfg = KernelConfig(),
+                             const std::string& name = "run_gte_comparison") {
   IRBuilder<> B(C);
 
   Type* I32  = Type::getInt32Ty(C);
+  Type* I64  = Type::getInt64Ty(C);
   PointerType* I32P = PointerType::getUnqual(I32);
 
-  // void run_gte_comparison(int* values, int length, int* comparisonResult, int testValue)
+  // void run_gte_comparison(int* values, int64_t length, int* comparisonResult, int testValue)
+  // Rows are indexed with i64 so a single call can cover columns past 2^31 rows.
   FunctionType* FT = FunctionType::get(Type::getVoidTy(C),
-                                       { I32P, I32, I32P, I32 },
+                                       { I32P, I64, I32P, I32 },
                                        false);
-  Function* F = Function::Create(FT, Function::ExternalLinkage,
-                                 "run_gte_comparison", M);
+  Function* F = Function::Create(FT, Function::ExternalLinkage, name, M);
 
   auto AI = F->arg_begin();
   Argument* values  = AI++; values->setName("values");
@@ -62,15 +134,73 @@ static Function* buildRunGte(Module& M, LLVMContext& C) {
   BasicBlock* exitBB  = BasicBlock::Create(C, "exit",  F);
 
   IRBuilder<> BE(entryBB);
-  Value* zero = ConstantInt::get(I32, 0);
-  BE.CreateBr(loopBB);
+  Value* zero = ConstantInt::get(I64, 0);
+
+  // Where the scalar loop starts: row 0, or wherever the vector loop stopped.
+  BasicBlock* scalarPred = entryBB;
+  Value* scalarStart = zero;
+
+  if (cfg.vectorWidth != 0) {
+    unsigned width = cfg.vectorWidth;
+    unsigned vecs = std::max(cfg.interleave, 1u);
+    int64_t step = int64_t(width) * vecs;  // power of two
+    auto* VecTy = FixedVectorType::get(I32, width);
+
+    BasicBlock* vloopBB = BasicBlock::Create(C, "vloop", F, loopBB);
+    BasicBlock* vbodyBB = BasicBlock::Create(C, "vbody", F, loopBB);
+    Value* vecEnd = BE.CreateAnd(length, ConstantInt::get(I64, -step), "vec.end");
+    BE.CreateBr(vloopBB);
+
+    IRBuilder<> BVL(vloopBB);
+    PHINode* vi = BVL.CreatePHI(I64, 2, "vi");
+    vi->addIncoming(zero, entryBB);
+    BVL.CreateCondBr(BVL.CreateICmpSLT(vi, vecEnd, "vinbounds"), vbodyBB, loopBB);
+
+    IRBuilder<> BV(vbodyBB);
+    if (cfg.prefetchDistance != 0) {
+      // Plain GEP: the address may run past the end, which prefetch tolerates.
+      Value* ahead = BV.CreateAdd(vi, ConstantInt::get(I64, cfg.prefetchDistance));
+      Value* pfPtr = BV.CreateGEP(I32, values, ahead, "pf.ptr");
+      // llvm.prefetch(ptr, rw=read, locality=none, cache=data)
+      BV.CreateIntrinsic(Intrinsic::prefetch, { pfPtr->getType() },
+                         { pfPtr, BV.getInt32(0), BV.getInt32(0), BV.getInt32(1) });
+    }
+    Value* splat = BV.CreateVectorSplat(width, testVal);
+    for (unsigned v = 0; v < vecs; v++) {
+      Value* row = BV.CreateNSWAdd(vi, ConstantInt::get(I64, int64_t(v) * width));
+      Value* src = BV.CreatePointerCast(BV.CreateInBoundsGEP(I32, values, row),
+                                        PointerType::getUnqual(VecTy));
+      Value* dst = BV.CreatePointerCast(BV.CreateInBoundsGEP(I32, out, row),
+                                        PointerType::getUnqual(VecTy));
+      Value* vals = BV.CreateAlignedLoad(VecTy, src, Align(4), "vals");
+      Value* ge = BV.CreateZExt(BV.CreateICmpSGE(vals, splat), VecTy, "ge.vec");
+      StoreInst* st = BV.CreateAlignedStore(ge, dst, Align(4));
+      if (cfg.streamingStores) {
+        st->setMetadata(LLVMContext::MD_nontemporal,
+                        MDNode::get(C, { ConstantAsMetadata::get(BV.getInt32(1)) }));
+      }
+    }
+    vi->addIncoming(BV.CreateNSWAdd(vi, ConstantInt::get(I64, step), "vi.next"),
+                    vbodyBB);
+    std::vector<std::pair<const char*, unsigned>> hints = {
+        { "llvm.loop.isvectorized", 1 } };
+    if (cfg.unroll != 0) {
+      hints.push_back({ "llvm.loop.unroll.count", cfg.unroll });
+    }
+    setLoopHints(BV.CreateBr(vloopBB), C, hints);
+
+    scalarPred = vloopBB;
+    scalarStart = vi;
+  } else {
+    BE.CreateBr(loopBB);
+  }
 
   IRBuilder<> BL(loopBB);
-  PHINode* i = BL.CreatePHI(I32, 2, "i");
-  i->addIncoming(zero, entryBB);
+  PHINode* i = BL.CreatePHI(I64, 2, "i");
+  i->addIncoming(scalarStart, scalarPred);
 
   Value* inBounds = BL.CreateICmpSLT(i, length, "inbounds");
-  BasicBlock* bodyBB = BasicBlock::Create(C, "body", F);
+  BasicBlock* bodyBB = BasicBlock::Create(C, "body", F, exitBB);
   BL.CreateCondBr(inBounds, bodyBB, exitBB);
 
   IRBuilder<> BB(bodyBB);
@@ -80,11 +210,391 @@ static Function* buildRunGte(Module& M, LLVMContext& C) {
   Value* geI32  = BB.CreateZExt(ge, I32, "ge.i32");
   Value* outPtr = BB.CreateInBoundsGEP(I32, out, i, "out.ptr");
   BB.CreateStore(geI32, outPtr);
-  Value* one    = ConstantInt::get(I32, 1);
-  Value* iNext  = BB.CreateAdd(i, one, "i.next");
-  BB.CreateBr(loopBB);
+  Value* one    = ConstantInt::get(I64, 1);
+  Value* iNext  = BB.CreateNSWAdd(i, one, "i.next");
+  BranchInst* latch = BB.CreateBr(loopBB);
   i->addIncoming(iNext, bodyBB);
 
+  if (cfg.vectorWidth != 0) {
+    // Remainder of the explicit vector loop; nothing left to vectorize.
+    setLoopHints(latch, C, { { "llvm.loop.isvectorized", 1 } });
+  } else {
+    std::vector<std::pair<const char*, unsigned>> hints;
+    if (cfg.interleave != 0) {
+      hints.push_back({ "llvm.loop.interleave.count", cfg.interleave });
+    }
+    if (cfg.unroll != 0) {
+      hints.push_back({ "llvm.loop.unroll.count", cfg.unroll });
+    }
+    setLoopHints(latch, C, hints);
+  }
+
+  IRBuilder<> BX(exitBB);
+  BX.CreateRetVoid();
+
+  if (verifyFunction(*F, &errs())) {
+    errs() << "Function verification failed!\n";
+  }
+  return F;
+}
+
+// ---------- IR Builder for run_gte_gather_<N> ----------
+// Fused filter + projection: for every row with values[i] >= testValue, append
+// payloads[p][i] to outs[p] for each of the N payload columns, and return the
+// number of matching rows. Each outs[p] must have room for `length` rows.
+//
+// With useCompress the main loop handles 8 rows at a time and writes each
+// payload through llvm.masked.compressstore (vpcompressd on AVX-512, compact
+// on SVE). Without it, and for the tail, rows are written branch-free: the
+// value is always stored at outs[p][k] and k only advances on a match.
+static Function* buildRunGteGather(Module& M, LLVMContext& C, int numPayloads,
+                                   bool useCompress) {
+  const unsigned kWidth = 8;
+
+  Type* I8   = Type::getInt8Ty(C);
+  Type* I32  = Type::getInt32Ty(C);
+  Type* I64  = Type::getInt64Ty(C);
+  PointerType* I32P  = PointerType::getUnqual(I32);
+  PointerType* I32PP = PointerType::getUnqual(I32P);
+  auto* VecTy = FixedVectorType::get(I32, kWidth);
+
+  // int64_t run_gte_gather_<N>(int* values, int64_t length, int testValue,
+  //                            int** payloads, int** outs)
+  FunctionType* FT = FunctionType::get(I64, { I32P, I64, I32, I32PP, I32PP },
+                                       false);
+  Function* F = Function::Create(FT, Function::ExternalLinkage,
+                                 "run_gte_gather_" + std::to_string(numPayloads),
+                                 M);
+
+  auto AI = F->arg_begin();
+  Argument* values   = AI++; values->setName("values");
+  Argument* length   = AI++; length->setName("length");
+  Argument* testVal  = AI++; testVal->setName("testValue");
+  Argument* payloads = AI++; payloads->setName("payloads");
+  Argument* outs     = AI++; outs->setName("outs");
+
+  BasicBlock* entryBB = BasicBlock::Create(C, "entry", F);
+  BasicBlock* loopBB  = BasicBlock::Create(C, "loop",  F);
+  BasicBlock* bodyBB  = BasicBlock::Create(C, "body",  F);
+  BasicBlock* exitBB  = BasicBlock::Create(C, "exit",  F);
+
+  // Column pointers are loop invariant, load them once.
+  IRBuilder<> BE(entryBB);
+  std::vector<Value*> inCols, outCols;
+  for (int p = 0; p < numPayloads; p++) {
+    Value* idx = ConstantInt::get(I64, p);
+    inCols.push_back(BE.CreateLoad(
+        I32P, BE.CreateInBoundsGEP(I32P, payloads, idx), "payload"));
+    outCols.push_back(BE.CreateLoad(
+        I32P, BE.CreateInBoundsGEP(I32P, outs, idx), "out"));
+  }
+  Value* zero = ConstantInt::get(I64, 0);
+  Value* one  = ConstantInt::get(I64, 1);
+
+  // Where the scalar loop picks up: row 0, or wherever the vector loop stopped.
+  BasicBlock* scalarPred = entryBB;
+  Value* scalarI = zero;
+  Value* scalarK = zero;
+
+  if (useCompress) {
+    BasicBlock* vloopBB = BasicBlock::Create(C, "vloop", F, loopBB);
+    BasicBlock* vbodyBB = BasicBlock::Create(C, "vbody", F, loopBB);
+    Value* vecEnd = BE.CreateAnd(length, ConstantInt::get(I64, -int64_t(kWidth)),
+                                 "vec.end");
+    BE.CreateBr(vloopBB);
+
+    IRBuilder<> BVL(vloopBB);
+    PHINode* vi = BVL.CreatePHI(I64, 2, "vi");
+    PHINode* vk = BVL.CreatePHI(I64, 2, "vk");
+    vi->addIncoming(zero, entryBB);
+    vk->addIncoming(zero, entryBB);
+    BVL.CreateCondBr(BVL.CreateICmpSLT(vi, vecEnd, "vinbounds"), vbodyBB, loopBB);
+
+#if LLVM_VERSION_MAJOR >= 20
+    Function* compress = Intrinsic::getOrInsertDeclaration(
+        &M, Intrinsic::masked_compressstore, { VecTy });
+    Function* ctpop = Intrinsic::getOrInsertDeclaration(&M, Intrinsic::ctpop, { I8 });
+#else
+    Function* compress = Intrinsic::getDeclaration(
+        &M, Intrinsic::masked_compressstore, { VecTy });
+    Function* ctpop = Intrinsic::getDeclaration(&M, Intrinsic::ctpop, { I8 });
+#endif
+
+    IRBuilder<> BV(vbodyBB);
+    auto loadVec = [&](Value* base, const Twine& name) {
+      Value* ptr = BV.CreateInBoundsGEP(I32, base, vi);
+      ptr = BV.CreatePointerCast(ptr, PointerType::getUnqual(VecTy));
+      return BV.CreateAlignedLoad(VecTy, ptr, Align(4), name);
+    };
+    Value* vals = loadVec(values, "vals");
+    Value* mask = BV.CreateICmpSGE(vals, BV.CreateVectorSplat(kWidth, testVal),
+                                   "mask");
+    for (int p = 0; p < numPayloads; p++) {
+      Value* src = loadVec(inCols[p], "payload.vec");
+      Value* dst = BV.CreateInBoundsGEP(I32, outCols[p], vk);
+      BV.CreateCall(compress, { src, dst, mask });
+    }
+    Value* cnt = BV.CreateZExt(BV.CreateCall(ctpop, { BV.CreateBitCast(mask, I8) }),
+                               I64, "cnt");
+    vk->addIncoming(BV.CreateNUWAdd(vk, cnt, "vk.next"), vbodyBB);
+    vi->addIncoming(BV.CreateNSWAdd(vi, ConstantInt::get(I64, kWidth), "vi.next"),
+                    vbodyBB);
+    BV.CreateBr(vloopBB);
+
+    scalarPred = vloopBB;
+    scalarI = vi;
+    scalarK = vk;
+  } else {
+    BE.CreateBr(loopBB);
+  }
+
+  // Scalar loop for the remainder (or everything without compress).
+  IRBuilder<> BL(loopBB);
+  PHINode* i = BL.CreatePHI(I64, 2, "i");
+  PHINode* k = BL.CreatePHI(I64, 2, "k");
+  i->addIncoming(scalarI, scalarPred);
+  k->addIncoming(scalarK, scalarPred);
+  BL.CreateCondBr(BL.CreateICmpSLT(i, length, "inbounds"), bodyBB, exitBB);
+
+  IRBuilder<> BB(bodyBB);
+  Value* val = BB.CreateLoad(I32, BB.CreateInBoundsGEP(I32, values, i), "val");
+  Value* ge  = BB.CreateICmpSGE(val, testVal, "ge");
+  for (int p = 0; p < numPayloads; p++) {
+    Value* v = BB.CreateLoad(I32, BB.CreateInBoundsGEP(I32, inCols[p], i),
+                             "payload.val");
+    BB.CreateStore(v, BB.CreateInBoundsGEP(I32, outCols[p], k));
+  }
+  k->addIncoming(BB.CreateNUWAdd(k, BB.CreateZExt(ge, I64), "k.next"), bodyBB);
+  i->addIncoming(BB.CreateNSWAdd(i, one, "i.next"), bodyBB);
+  BB.CreateBr(loopBB);
+
+  IRBuilder<> BX(exitBB);
+  BX.CreateRet(k);
+
+  if (verifyFunction(*F, &errs())) {
+    errs() << "Function verification failed!\n";
+  }
+  return F;
+}
+
+// ---------- IR Builder for run_gte_multi_<K> / run_gte_count_<K> ----------
+// Shared scan: K concurrent `values[i] >= tests[k]` filters over one column in
+// a single pass, so the column is read once instead of K times. Each group of
+// 8 rows is loaded once and compared against all K splatted thresholds, which
+// stay in vector registers for the whole loop.
+//
+// counts[k] gets the number of matching rows. run_gte_multi_<K> also writes
+// bitmap k: bit i % 8 of bitmaps[k][i / 8] is row i's result, so each bitmap
+// needs (length + 7) / 8 bytes. run_gte_count_<K> ignores `bitmaps`.
+//
+// Past a dozen bitmaps the K interleaved store streams cost more than the
+// shared load saves. Counts alone measured faster than run_gte_rank up to
+// ~64 tests; the cutoff sits at 48 to leave margin for other machines.
+static const int kMaxSharedScanBitmaps = 12;
+static const int kMaxSharedScanCounts = 48;
+
+static Function* buildRunGteMulti(Module& M, LLVMContext& C, int numTests,
+                                  bool withBitmaps) {
+  const unsigned kWidth = 8;
+
+  Type* I8   = Type::getInt8Ty(C);
+  Type* I32  = Type::getInt32Ty(C);
+  Type* I64  = Type::getInt64Ty(C);
+  PointerType* I8P   = PointerType::getUnqual(I8);
+  PointerType* I8PP  = PointerType::getUnqual(I8P);
+  PointerType* I32P  = PointerType::getUnqual(I32);
+  PointerType* I64P  = PointerType::getUnqual(I64);
+  auto* VecTy = FixedVectorType::get(I32, kWidth);
+
+  // void run_gte_multi_<K>(int* values, int64_t length, int* tests,
+  //                        int64_t* counts, uint8_t** bitmaps)
+  FunctionType* FT = FunctionType::get(Type::getVoidTy(C),
+                                       { I32P, I64, I32P, I64P, I8PP }, false);
+  Function* F = Function::Create(
+      FT, Function::ExternalLinkage,
+      (withBitmaps ? "run_gte_multi_" : "run_gte_count_") + std::to_string(numTests),
+      M);
+
+  auto AI = F->arg_begin();
+  Argument* values  = AI++; values->setName("values");
+  Argument* length  = AI++; length->setName("length");
+  Argument* tests   = AI++; tests->setName("tests");
+  Argument* counts  = AI++; counts->setName("counts");
+  Argument* bitmaps = AI++; bitmaps->setName("bitmaps");
+
+  BasicBlock* entryBB = BasicBlock::Create(C, "entry", F);
+  BasicBlock* vloopBB = BasicBlock::Create(C, "vloop", F);
+  BasicBlock* vbodyBB = BasicBlock::Create(C, "vbody", F);
+  BasicBlock* loopBB  = BasicBlock::Create(C, "loop",  F);
+  BasicBlock* bodyBB  = BasicBlock::Create(C, "body",  F);
+  BasicBlock* tailBB  = BasicBlock::Create(C, "tail",  F);
+  BasicBlock* exitBB  = BasicBlock::Create(C, "exit",  F);
+
+  // Thresholds and bitmap pointers are loop invariant, load them once.
+  IRBuilder<> BE(entryBB);
+  std::vector<Value*> testVals, splats, maps;
+  for (int t = 0; t < numTests; t++) {
+    Value* idx = ConstantInt::get(I64, t);
+    testVals.push_back(BE.CreateLoad(I32, BE.CreateInBoundsGEP(I32, tests, idx),
+                                     "test"));
+    splats.push_back(BE.CreateVectorSplat(kWidth, testVals.back(), "test.splat"));
+    if (withBitmaps) {
+      maps.push_back(BE.CreateLoad(I8P, BE.CreateInBoundsGEP(I8P, bitmaps, idx),
+                                   "bitmap"));
+    }
+  }
+  Value* zero = ConstantInt::get(I64, 0);
+  Value* vecEnd = BE.CreateAnd(length, ConstantInt::get(I64, -int64_t(kWidth)),
+                               "vec.end");
+  BE.CreateBr(vloopBB);
+
+#if LLVM_VERSION_MAJOR >= 20
+  Function* ctpop = Intrinsic::getOrInsertDeclaration(&M, Intrinsic::ctpop, { I8 });
+#else
+  Function* ctpop = Intrinsic::getDeclaration(&M, Intrinsic::ctpop, { I8 });
+#endif
+
+  // Vector loop: 8 rows per iteration, one bitmap byte per threshold.
+  IRBuilder<> BVL(vloopBB);
+  PHINode* vi = BVL.CreatePHI(I64, 2, "vi");
+  vi->addIncoming(zero, entryBB);
+  std::vector<PHINode*> vcnt;
+  for (int t = 0; t < numTests; t++) {
+    vcnt.push_back(BVL.CreatePHI(I64, 2, "vcnt"));
+    vcnt[t]->addIncoming(zero, entryBB);
+  }
+  BVL.CreateCondBr(BVL.CreateICmpSLT(vi, vecEnd, "vinbounds"), vbodyBB, loopBB);
+
+  IRBuilder<> BV(vbodyBB);
+  Value* src = BV.CreatePointerCast(BV.CreateInBoundsGEP(I32, values, vi),
+                                    PointerType::getUnqual(VecTy));
+  Value* vals = BV.CreateAlignedLoad(VecTy, src, Align(4), "vals");
+  Value* byteIdx = BV.CreateLShr(vi, 3, "byte.idx");
+  for (int t = 0; t < numTests; t++) {
+    Value* bits = BV.CreateBitCast(BV.CreateICmpSGE(vals, splats[t]), I8, "bits");
+    if (withBitmaps) {
+      BV.CreateStore(bits, BV.CreateInBoundsGEP(I8, maps[t], byteIdx));
+    }
+    Value* cnt = BV.CreateZExt(BV.CreateCall(ctpop, { bits }), I64);
+    vcnt[t]->addIncoming(BV.CreateNUWAdd(vcnt[t], cnt, "vcnt.next"), vbodyBB);
+  }
+  vi->addIncoming(BV.CreateNSWAdd(vi, ConstantInt::get(I64, kWidth), "vi.next"),
+                  vbodyBB);
+  BV.CreateBr(vloopBB);
+
+  // Scalar loop over the last < 8 rows, building one partial byte per
+  // threshold.
+  IRBuilder<> BL(loopBB);
+  PHINode* i = BL.CreatePHI(I64, 2, "i");
+  i->addIncoming(vi, vloopBB);
+  std::vector<PHINode*> cnt, partial;
+  for (int t = 0; t < numTests; t++) {
+    cnt.push_back(BL.CreatePHI(I64, 2, "cnt"));
+    cnt[t]->addIncoming(vcnt[t], vloopBB);
+    partial.push_back(BL.CreatePHI(I8, 2, "partial"));
+    partial[t]->addIncoming(ConstantInt::get(I8, 0), vloopBB);
+  }
+  BL.CreateCondBr(BL.CreateICmpSLT(i, length, "inbounds"), bodyBB, tailBB);
+
+  IRBuilder<> BB(bodyBB);
+  Value* val = BB.CreateLoad(I32, BB.CreateInBoundsGEP(I32, values, i), "val");
+  Value* shift = BB.CreateTrunc(BB.CreateSub(i, vecEnd), I8, "shift");
+  for (int t = 0; t < numTests; t++) {
+    Value* ge = BB.CreateICmpSGE(val, testVals[t], "ge");
+    cnt[t]->addIncoming(BB.CreateNUWAdd(cnt[t], BB.CreateZExt(ge, I64)), bodyBB);
+    partial[t]->addIncoming(
+        BB.CreateOr(partial[t], BB.CreateShl(BB.CreateZExt(ge, I8), shift)), bodyBB);
+  }
+  i->addIncoming(BB.CreateNSWAdd(i, ConstantInt::get(I64, 1), "i.next"), bodyBB);
+  setLoopHints(BB.CreateBr(loopBB), C, { { "llvm.loop.isvectorized", 1 } });
+
+  // Counts always; the partial bytes only if there was a remainder.
+  IRBuilder<> BT(tailBB);
+  for (int t = 0; t < numTests; t++) {
+    BT.CreateStore(cnt[t], BT.CreateInBoundsGEP(I64, counts, ConstantInt::get(I64, t)));
+  }
+  if (withBitmaps) {
+    BasicBlock* partialBB = BasicBlock::Create(C, "store.partial", F, exitBB);
+    BT.CreateCondBr(BT.CreateICmpSLT(vecEnd, length, "has.partial"), partialBB, exitBB);
+    IRBuilder<> BP(partialBB);
+    Value* lastByte = BP.CreateLShr(vecEnd, 3, "last.byte");
+    for (int t = 0; t < numTests; t++) {
+      BP.CreateStore(partial[t], BP.CreateInBoundsGEP(I8, maps[t], lastByte));
+    }
+    BP.CreateBr(exitBB);
+  } else {
+    BT.CreateBr(exitBB);
+  }
+
+  IRBuilder<> BX(exitBB);
+  BX.CreateRetVoid();
+
+  if (verifyFunction(*F, &errs())) {
+    errs() << "Function verification failed!\n";
+  }
+  return F;
+}
+
+// ---------- IR Builder for run_gte_rank_<P> ----------
+// Sort-and-rank for more thresholds than fit in registers: with the tests
+// sorted ascending, the set a row passes is fully described by its rank, the
+// number of tests <= the value. The kernel only histograms the ranks; suffix
+// sums over the histogram then give every count (see multiGteCounts). The
+// rank is a branch-free binary search over P = 2^m sorted tests, any padding
+// past the real ones only lands in histogram slots no count reads.
+//
+// void run_gte_rank_<P>(int* values, int64_t length, int* sortedTests,
+//                       int64_t* histogram)   // P + 1 slots, caller zeroes
+static Function* buildRunGteRank(Module& M, LLVMContext& C, unsigned numSlots) {
+  Type* I32  = Type::getInt32Ty(C);
+  Type* I64  = Type::getInt64Ty(C);
+  PointerType* I32P = PointerType::getUnqual(I32);
+  PointerType* I64P = PointerType::getUnqual(I64);
+
+  FunctionType* FT = FunctionType::get(Type::getVoidTy(C),
+                                       { I32P, I64, I32P, I64P }, false);
+  Function* F = Function::Create(FT, Function::ExternalLinkage,
+                                 "run_gte_rank_" + std::to_string(numSlots), M);
+
+  auto AI = F->arg_begin();
+  Argument* values = AI++; values->setName("values");
+  Argument* length = AI++; length->setName("length");
+  Argument* sorted = AI++; sorted->setName("sortedTests");
+  Argument* hist   = AI++; hist->setName("histogram");
+
+  BasicBlock* entryBB = BasicBlock::Create(C, "entry", F);
+  BasicBlock* loopBB  = BasicBlock::Create(C, "loop",  F);
+  BasicBlock* bodyBB  = BasicBlock::Create(C, "body",  F);
+  BasicBlock* exitBB  = BasicBlock::Create(C, "exit",  F);
+
+  IRBuilder<> BE(entryBB);
+  BE.CreateBr(loopBB);
+
+  IRBuilder<> BL(loopBB);
+  PHINode* i = BL.CreatePHI(I64, 2, "i");
+  i->addIncoming(ConstantInt::get(I64, 0), entryBB);
+  BL.CreateCondBr(BL.CreateICmpSLT(i, length, "inbounds"), bodyBB, exitBB);
+
+  IRBuilder<> BB(bodyBB);
+  Value* val = BB.CreateLoad(I32, BB.CreateInBoundsGEP(I32, values, i), "val");
+  auto passes = [&](Value* pos) {
+    Value* test = BB.CreateLoad(I32, BB.CreateInBoundsGEP(I32, sorted, pos), "test");
+    return BB.CreateICmpSGE(val, test, "ge");
+  };
+  // Invariant: sortedTests[0 .. pos) are all <= val.
+  Value* pos = ConstantInt::get(I64, 0);
+  for (unsigned step = numSlots / 2; step >= 1; step /= 2) {
+    Value* probe = BB.CreateAdd(pos, ConstantInt::get(I64, step - 1));
+    pos = BB.CreateAdd(pos, BB.CreateSelect(passes(probe), ConstantInt::get(I64, step),
+                                            ConstantInt::get(I64, 0)), "pos");
+  }
+  Value* rank = BB.CreateAdd(pos, BB.CreateZExt(passes(pos), I64), "rank");
+  Value* slot = BB.CreateInBoundsGEP(I64, hist, rank);
+  BB.CreateStore(BB.CreateAdd(BB.CreateLoad(I64, slot), ConstantInt::get(I64, 1)),
+                 slot);
+  i->addIncoming(BB.CreateNSWAdd(i, ConstantInt::get(I64, 1), "i.next"), bodyBB);
+  BB.CreateBr(loopBB);
+
   IRBuilder<> BX(exitBB);
   BX.CreateRetVoid();
 
@@ -95,7 +605,7 @@ static Function* buildRunGte(Module& M, LLVMContext& C) {
 }
 
 // ---------- IR-level optimization with PassBuilder ----------
-#if LLVM_VERSION_MAJOR >= 16
+#if LLVM_VERSION_MAJOR >= 14
 using OptLevelT = llvm::OptimizationLevel; // modern
 #else
 using OptLevelT = llvm::PassBuilder::OptimizationLevel; // older PB signature
@@ -125,21 +635,472 @@ static void optimizeModule(Module& M, OptLevelT Level) {
   MPM.run(M, MAM);
 }
 
-std::vector<int> generate(int n) {
-  std::vector<int> result(n);
-  for (int i = 0; i < n; i++) {
-    result[i] = rand() % 100000;
+// ---------- JIT helpers ----------
+template <typename FnT>
+static FnT lookupFn(LLJIT& J, StringRef name) {
+  auto Sym = J.lookup(name);
+  if (!Sym) {
+    errs() << "lookup failed: " << toString(Sym.takeError()) << "\n";
+    return nullptr;
+  }
+#if LLVM_VERSION_MAJOR >= 17
+  return Sym->toPtr<FnT>();
+#else
+  return reinterpret_cast<FnT>(Sym->getAddress());
+#endif
+}
+
+static bool addOptimizedModule(LLJIT& J, std::unique_ptr<Module> Mod,
+                               std::unique_ptr<LLVMContext> Ctx) {
+#if LLVM_VERSION_MAJOR >= 14
+  optimizeModule(*Mod, OptimizationLevel::O3);
+#else
+  optimizeModule(*Mod, PassBuilder::OptimizationLevel::O3);
+#endif
+  ThreadSafeModule TSM(std::move(Mod), std::move(Ctx));
+  if (auto Err = J.addIRModule(std::move(TSM))) {
+    errs() << "addIRModule failed: " << toString(std::move(Err)) << "\n";
+    return false;
+  }
+  return true;
+}
+
+// ---------- Huge-page backed column buffers ----------
+// Columns past 2^31 rows span tens of GB, and with 4K pages the scan spends a
+// noticeable share of its time on TLB misses. Try explicit huge pages first
+// (needs vm.nr_hugepages), then fall back to a plain mapping advised for THP.
+template <typename T>
+class HugePageBuffer {
+ public:
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  explicit HugePageBuffer(int64_t length) : length_(length) {
+    bytes_ = (length * sizeof(T) + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    if (bytes_ == 0) {
+      return;
+    }
+#ifdef MAP_HUGETLB
+    data_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    explicitHuge_ = data_ != MAP_FAILED;
+#endif
+    if (!explicitHuge_) {
+      data_ = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (data_ == MAP_FAILED) {
+        // Built with -fno-exceptions; callers check ok() instead.
+        data_ = nullptr;
+        bytes_ = 0;
+        return;
+      }
+#ifdef MADV_HUGEPAGE
+      madvise(data_, bytes_, MADV_HUGEPAGE);
+#endif
+    }
+  }
+
+  ~HugePageBuffer() {
+    if (bytes_ != 0) {
+      munmap(data_, bytes_);
+    }
+  }
+
+  HugePageBuffer(const HugePageBuffer&) = delete;
+  HugePageBuffer& operator=(const HugePageBuffer&) = delete;
+
+  T* data() { return static_cast<T*>(data_); }
+  // False only if a non-empty mapping failed; an empty buffer has no data().
+  bool ok() const { return length_ == 0 || data_ != nullptr; }
+  int64_t size() const { return length_; }
+  bool explicitHugePages() const { return explicitHuge_; }
+
+ private:
+  void* data_ = nullptr;
+  size_t bytes_ = 0;
+  int64_t length_;
+  bool explicitHuge_ = false;
+};
+
+void generate(int* dest, int64_t n) {
+  for (int64_t i = 0; i < n; i++) {
+    dest[i] = rand() % 100000;
   }
-  return result;
 }
 
-void manual(int *values, int length, int *dest, int testValue) {
-  for (int idx = 0; idx < length; idx++) {
+void manual(int *values, int64_t length, int *dest, int testValue) {
+  for (int64_t idx = 0; idx < length; idx++) {
     dest[idx] = values[idx] >= testValue ? 1 : 0;
   }
 }
 
-int main() {
+// ---------- Kernel auto-tuning ----------
+// The O3 defaults leave throughput on the table on some machines, so --tune
+// JITs a grid of KernelConfig variants, times each on the current input and
+// records the fastest one keyed by (kernel signature, host CPU). Later runs
+// read that entry back and compile the kernel with it.
+static const char* kRunGteSignature = "run_gte_comparison(i32*,i64,i32*,i32)";
+static const char* kDefaultConfigCache = "kernel_configs.txt";
+
+static std::string configKey(const std::string& signature) {
+  return signature + "@" + sys::getHostCPUName().str();
+}
+
+// One "<key>\t<config>" entry per line.
+static bool loadTunedConfig(const std::string& path, const std::string& key,
+                            KernelConfig& cfg) {
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    size_t tab = line.find('\t');
+    if (tab != std::string::npos && line.compare(0, tab, key) == 0) {
+      return KernelConfig::parse(line.substr(tab + 1), cfg);
+    }
+  }
+  return false;
+}
+
+static void saveTunedConfig(const std::string& path, const std::string& key,
+                            const KernelConfig& cfg) {
+  std::vector<std::string> lines;
+  {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.compare(0, key.size() + 1, key + "\t") != 0) {
+        lines.push_back(line);
+      }
+    }
+  }
+  lines.push_back(key + "\t" + cfg.str());
+  std::ofstream out(path, std::ios::trunc);
+  for (const std::string& line : lines) {
+    out << line << "\n";
+  }
+}
+
+// grid[0] is the all-defaults config, i.e. what runs without tuning.
+static std::vector<KernelConfig> tuningGrid() {
+  std::vector<KernelConfig> grid;
+  for (unsigned width : { 0u, 4u, 8u, 16u }) {
+    for (unsigned interleave : { 0u, 2u, 4u }) {
+      for (unsigned unroll : { 0u, 2u }) {
+        for (unsigned prefetch : { 0u, 1024u, 4096u }) {
+          for (bool streaming : { false, true }) {
+            if (width == 0 && (prefetch != 0 || streaming)) {
+              continue;  // only meaningful for the explicit vector loop
+            }
+            KernelConfig cfg;
+            cfg.vectorWidth = width;
+            cfg.interleave = interleave;
+            cfg.unroll = unroll;
+            cfg.prefetchDistance = prefetch;
+            cfg.streamingStores = streaming;
+            grid.push_back(cfg);
+          }
+        }
+      }
+    }
+  }
+  return grid;
+}
+
+using RunGteFn = void(*)(int*, int64_t, int*, int);
+
+// Best-of-`reps` wall time, after one warm-up call to fault in the pages.
+static double timeRunGte(RunGteFn fn, int* values, int64_t n, int* results,
+                         int testValue, int reps) {
+  fn(values, n, results, testValue);
+  double best = 1e100;
+  for (int r = 0; r < reps; r++) {
+    auto st = std::chrono::steady_clock::now();
+    fn(values, n, results, testValue);
+    auto en = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(en - st).count());
+  }
+  return best;
+}
+
+static bool tuneRunGte(LLJIT& J, int* values, int64_t n, int* results,
+                       int testValue, KernelConfig& best) {
+  std::vector<KernelConfig> grid = tuningGrid();
+
+  // All variants go into one module so they share a single O3 + codegen run.
+  auto Ctx = std::make_unique<LLVMContext>();
+  auto Mod = std::make_unique<Module>("gte_tune_module", *Ctx);
+  Mod->setDataLayout(J.getDataLayout());
+  for (size_t v = 0; v < grid.size(); v++) {
+    buildRunGte(*Mod, *Ctx, grid[v], "run_gte_tune_" + std::to_string(v));
+  }
+  if (!addOptimizedModule(J, std::move(Mod), std::move(Ctx))) {
+    return false;
+  }
+
+  // A variant only counts if it still computes the right answer.
+  HugePageBuffer<int> expected(n);
+  if (!expected.ok()) {
+    errs() << "failed to map " << n << " rows\n";
+    return false;
+  }
+  manual(values, n, expected.data(), testValue);
+
+  double bestTime = 1e100, defaultTime = 0;
+  for (size_t v = 0; v < grid.size(); v++) {
+    auto fn = lookupFn<RunGteFn>(J, "run_gte_tune_" + std::to_string(v));
+    if (!fn) {
+      return false;
+    }
+    // Not 0 or 1, so rows a variant fails to write show up as wrong.
+    memset(results, 0xFF, n * sizeof(int));
+    double t = timeRunGte(fn, values, n, results, testValue, 3);
+    if (v == 0) {
+      defaultTime = t;
+    }
+    if (!std::equal(expected.data(), expected.data() + n, results)) {
+      errs() << "variant " << grid[v].str() << " produced wrong results\n";
+      continue;
+    }
+    if (t < bestTime) {
+      bestTime = t;
+      best = grid[v];
+    }
+  }
+  std::cerr << "tuned " << grid.size() << " variants on "
+            << sys::getHostCPUName().str() << ": default " << defaultTime
+            << "s, best " << bestTime << "s (" << best.str() << ")" << std::endl;
+  return true;
+}
+
+// Filter + projection the way it is done without a fused kernel: materialize a
+// selection vector, then gather each payload column through it.
+int64_t manualGather(int* values, int64_t length, int testValue,
+                     int** payloads, int** outs, int numPayloads,
+                     int64_t* selection) {
+  int64_t k = 0;
+  for (int64_t idx = 0; idx < length; idx++) {
+    if (values[idx] >= testValue) {
+      selection[k++] = idx;
+    }
+  }
+  for (int p = 0; p < numPayloads; p++) {
+    for (int64_t j = 0; j < k; j++) {
+      outs[p][j] = payloads[p][selection[j]];
+    }
+  }
+  return k;
+}
+
+// K concurrent filters the way they run without a shared scan: one pass over
+// the column per threshold.
+void manualMultiCounts(int* values, int64_t length, const std::vector<int>& tests,
+                       int64_t* counts) {
+  for (size_t t = 0; t < tests.size(); t++) {
+    int64_t k = 0;
+    for (int64_t idx = 0; idx < length; idx++) {
+      k += values[idx] >= tests[t];
+    }
+    counts[t] = k;
+  }
+}
+
+using RunGteRankFn = void(*)(int*, int64_t, int*, int64_t*);
+
+// Counts for every threshold through run_gte_rank_<numSlots>, which must have
+// at least tests.size() slots. counts[t] belongs to tests[t].
+static void multiGteCounts(RunGteRankFn rank, unsigned numSlots, int* values,
+                           int64_t length, const std::vector<int>& tests,
+                           int64_t* counts) {
+  std::vector<int> order(tests.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&](int a, int b) { return tests[a] < tests[b]; });
+  std::vector<int> sorted(numSlots, INT_MAX);
+  for (size_t j = 0; j < order.size(); j++) {
+    sorted[j] = tests[order[j]];
+  }
+  std::vector<int64_t> hist(numSlots + 1, 0);
+  rank(values, length, sorted.data(), hist.data());
+  // A row passes sorted test j exactly when its rank is above j.
+  int64_t above = 0;
+  for (size_t r = numSlots; r >= 1; r--) {
+    above += hist[r];
+    if (r - 1 < order.size()) {
+      counts[order[r - 1]] = above;
+    }
+  }
+}
+
+// ---------- Sortedness-aware filtering ----------
+// Many columns are sorted, or are a few sorted batches appended together, or
+// are at least clustered. A full scan writing a 0/1 per row then does O(n)
+// work for an answer that is a handful of row ranges. ColumnOrder is the
+// metadata that lets filterGteRanges skip it: computed once per column by
+// analyzeColumn, or supplied by whoever loads a column known to be sorted.
+struct RowRange {
+  int64_t begin, end;  // [begin, end)
+};
+
+struct ColumnOrder {
+  static constexpr int64_t kZoneRows = 4096;
+  // Searching runs beats the zone map while runs average this many rows.
+  static constexpr int64_t kMinRunRows = 1024;
+  // Ranges only beat the dense kernel while at most 1 / kMaxMixedZones of the
+  // zones straddle the threshold and need scanning.
+  static constexpr int64_t kMaxMixedZones = 8;
+
+  // Start rows of the maximal non-decreasing runs, then the column length.
+  // Empty when there are too many runs to be worth searching.
+  std::vector<int64_t> runStarts;
+  // Min / max of each kZoneRows block; empty if not computed.
+  std::vector<int> zoneMin, zoneMax;
+
+  static ColumnOrder sorted(int64_t length) {
+    ColumnOrder order;
+    order.runStarts = { 0, length };
+    return order;
+  }
+
+  static int64_t maxRuns(int64_t length) {
+    return std::max<int64_t>(length / kMinRunRows, 1);
+  }
+  int64_t numRuns() const { return std::max<int64_t>(int64_t(runStarts.size()) - 1, 0); }
+};
+
+// One pass: run boundaries, until there are too many, and the zone map.
+static ColumnOrder analyzeColumn(const int* values, int64_t length) {
+  ColumnOrder order;
+  const int64_t maxRuns = ColumnOrder::maxRuns(length);
+  bool trackRuns = true;
+  order.runStarts.push_back(0);
+  for (int64_t zone = 0; zone < length; zone += ColumnOrder::kZoneRows) {
+    int64_t end = std::min(zone + ColumnOrder::kZoneRows, length);
+    int lo = values[zone], hi = values[zone];
+    for (int64_t idx = zone; idx < end; idx++) {
+      lo = std::min(lo, values[idx]);
+      hi = std::max(hi, values[idx]);
+    }
+    order.zoneMin.push_back(lo);
+    order.zoneMax.push_back(hi);
+    for (int64_t idx = std::max<int64_t>(zone, 1); idx < end && trackRuns; idx++) {
+      if (values[idx] < values[idx - 1]) {
+        order.runStarts.push_back(idx);
+        trackRuns = order.numRuns() < maxRuns;
+      }
+    }
+  }
+  if (trackRuns) {
+    order.runStarts.push_back(length);
+  } else {
+    order.runStarts.clear();
+  }
+  return order;
+}
+
+// Appends [begin, end), merging it into the previous range when they touch.
+static void appendRange(std::vector<RowRange>& out, int64_t begin, int64_t end) {
+  if (begin >= end) {
+    return;
+  }
+  if (!out.empty() && out.back().end == begin) {
+    out.back().end = end;
+  } else {
+    out.push_back({ begin, end });
+  }
+}
+
+// First row in the non-decreasing values[begin, end) with value >= testValue.
+// Gallops back from the end, so a selective filter costs O(log matches).
+static int64_t gallopLowerBound(const int* values, int64_t begin, int64_t end,
+                                int testValue) {
+  int64_t hi = end, step = 1;
+  while (hi - step >= begin && values[hi - step] >= testValue) {
+    hi -= step;
+    step *= 2;
+  }
+  int64_t lo = std::max(begin, hi - step);
+  return std::lower_bound(values + lo, values + hi, testValue) - values;
+}
+
+// Rows with values[i] >= testValue, as sorted disjoint ranges in `out`. With
+// few runs each run contributes its matching suffix. Otherwise the zone map
+// decides whole blocks and only mixed blocks are scanned, run-length encoded.
+// Returns false, leaving `out` empty, if too many blocks are mixed or there is
+// no zone map: the dense run_gte_comparison scan is the better answer then.
+static bool filterGteRanges(const int* values, int64_t length,
+                            const ColumnOrder& order, int testValue,
+                            std::vector<RowRange>& out) {
+  out.clear();
+  if (order.numRuns() > 0) {
+    for (int64_t r = 0; r < order.numRuns(); r++) {
+      int64_t begin = order.runStarts[r], end = order.runStarts[r + 1];
+      appendRange(out, gallopLowerBound(values, begin, end, testValue), end);
+    }
+    return true;
+  }
+  const int64_t zones = order.zoneMin.size();
+  int64_t mixed = 0;
+  for (int64_t z = 0; z < zones; z++) {
+    mixed += order.zoneMin[z] < testValue && order.zoneMax[z] >= testValue;
+  }
+  if (zones == 0 || mixed * ColumnOrder::kMaxMixedZones > zones) {
+    return false;
+  }
+  for (int64_t z = 0; z < zones; z++) {
+    int64_t begin = z * ColumnOrder::kZoneRows;
+    int64_t end = std::min(begin + ColumnOrder::kZoneRows, length);
+    if (order.zoneMin[z] >= testValue) {
+      appendRange(out, begin, end);
+    } else if (order.zoneMax[z] >= testValue) {
+      for (int64_t idx = begin; idx < end;) {
+        while (idx < end && values[idx] < testValue) {
+          idx++;
+        }
+        int64_t match = idx;
+        while (idx < end && values[idx] >= testValue) {
+          idx++;
+        }
+        appendRange(out, match, idx);
+      }
+    }
+  }
+  return true;
+}
+
+// masked.compressstore is legal everywhere, but only lowers to a single
+// instruction with AVX-512 (vpcompressd) or SVE (compact); elsewhere it gets
+// scalarized into a branch per lane, which is worse than the branch-free loop.
+static bool hostHasCompress(JITTargetMachineBuilder& JTMB) {
+  for (const std::string& F : JTMB.getFeatures().getFeatures()) {
+    if (F == "+avx512f" || F == "+sve") {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Rows of the column the multi-threshold and row-range demos run on; see
+// --demo-rows.
+static const int64_t kDefaultDemoRows = int64_t(1) << 24;
+
+int main(int argc, char** argv) {
+  int numPayloads = 2;
+  int numTests = 8;
+  int64_t demoRows = kDefaultDemoRows;
+  bool tune = false;
+  std::string configCache = kDefaultConfigCache;
+  for (int a = 1; a < argc; a++) {
+    if (strncmp(argv[a], "--payloads=", 11) == 0) {
+      numPayloads = atoi(argv[a] + 11);
+    } else if (strncmp(argv[a], "--demo-rows=", 12) == 0) {
+      demoRows = std::max<int64_t>(atoll(argv[a] + 12), 0);
+    } else if (strncmp(argv[a], "--tests=", 8) == 0) {
+      numTests = std::max(atoi(argv[a] + 8), 1);
+    } else if (strcmp(argv[a], "--tune") == 0) {
+      tune = true;
+    } else if (strncmp(argv[a], "--config-cache=", 15) == 0) {
+      configCache = argv[a] + 15;
+    }
+  }
+
   // 1) Native target init for JIT
   InitializeNativeTarget();
   InitializeNativeTargetAsmPrinter();
@@ -152,7 +1113,12 @@ int main() {
     return 1;
   }
   // Set the codegen optimization level for lowering (instruction selection, regalloc, etc.)
+#if LLVM_VERSION_MAJOR >= 18
   JTMB->setCodeGenOptLevel(CodeGenOptLevel::Aggressive);
+#else
+  JTMB->setCodeGenOptLevel(CodeGenOpt::Aggressive);
+#endif
+  bool useCompress = hostHasCompress(*JTMB);
 
   auto JITExpected = LLJITBuilder()
       .setJITTargetMachineBuilder(std::move(*JTMB))
@@ -163,7 +1129,35 @@ int main() {
   }
   std::unique_ptr<LLJIT> J = std::move(*JITExpected);
 
-  // 3) Build module + function
+  // 3) Read the input and materialize the columns
+  int64_t n;
+  int testValue;
+  std::cin >> n;
+  std::cin >> testValue;
+  HugePageBuffer<int> values(n);
+  HugePageBuffer<int> results(n);
+  if (!values.ok() || !results.ok()) {
+    errs() << "failed to map " << n << " rows\n";
+    return 1;
+  }
+  generate(values.data(), n);
+  if (!values.explicitHugePages()) {
+    std::cerr << "note: no explicit huge pages, relying on THP" << std::endl;
+  }
+
+  // 4) Pick the kernel configuration: tune now, or reuse a cached result
+  KernelConfig cfg;
+  std::string key = configKey(kRunGteSignature);
+  if (tune) {
+    if (!tuneRunGte(*J, values.data(), n, results.data(), testValue, cfg)) {
+      return 1;
+    }
+    saveTunedConfig(configCache, key, cfg);
+  } else if (loadTunedConfig(configCache, key, cfg)) {
+    std::cerr << "using tuned config: " << cfg.str() << std::endl;
+  }
+
+  // 5) Build module + function
   auto Ctx = std::make_unique<LLVMContext>();
   auto Mod = std::make_unique<Module>("gte_module", *Ctx);
 
@@ -172,48 +1166,63 @@ int main() {
   // (Optional) Target triple – often not required for JIT, but harmless:
   // Mod->setTargetTriple(sys::getProcessTriple());
 
-  buildRunGte(*Mod, *Ctx);
-
-  // 4) Run IR optimization at -O3
-#if LLVM_VERSION_MAJOR >= 16
-  optimizeModule(*Mod, OptimizationLevel::O3);
-#else
-  optimizeModule(*Mod, PassBuilder::OptimizationLevel::O3);
-#endif
+  buildRunGte(*Mod, *Ctx, cfg);
+  buildRunGteGather(*Mod, *Ctx, numPayloads, useCompress);
+  // A shared scan while the thresholds fit, sort-and-rank beyond that.
+  bool bitmapScan = numTests <= kMaxSharedScanBitmaps;
+  bool countScan = numTests <= kMaxSharedScanCounts;
+  unsigned rankSlots = 1;
+  while (rankSlots < unsigned(numTests)) {
+    rankSlots <<= 1;
+  }
+  if (bitmapScan) {
+    buildRunGteMulti(*Mod, *Ctx, numTests, true);
+  }
+  if (countScan) {
+    buildRunGteMulti(*Mod, *Ctx, numTests, false);
+  } else {
+    buildRunGteRank(*Mod, *Ctx, rankSlots);
+  }
 
-  // (Optional) View IR after optimization
+  // (Optional) View IR before optimization
   // Mod->print(outs(), nullptr);
 
-  // 5) Add to the JIT and look up the symbol
-  ThreadSafeModule TSM(std::move(Mod), std::move(Ctx));
-  if (auto Err = J->addIRModule(std::move(TSM))) {
-    errs() << "addIRModule failed: " << toString(std::move(Err)) << "\n";
+  // 6) Run IR optimization at -O3, add to the JIT and look up the symbols
+  if (!addOptimizedModule(*J, std::move(Mod), std::move(Ctx))) {
     return 1;
   }
 
-  auto Sym = J->lookup("run_gte_comparison");
-  if (!Sym) {
-    errs() << "lookup failed: " << toString(Sym.takeError()) << "\n";
+  RunGteFn run_gte = lookupFn<RunGteFn>(*J, "run_gte_comparison");
+  using RunGteGatherFn = int64_t(*)(int*, int64_t, int, int**, int**);
+  RunGteGatherFn run_gte_gather = lookupFn<RunGteGatherFn>(
+      *J, "run_gte_gather_" + std::to_string(numPayloads));
+  if (!run_gte || !run_gte_gather) {
+    return 1;
+  }
+  using RunGteMultiFn = void(*)(int*, int64_t, int*, int64_t*, uint8_t**);
+  RunGteMultiFn run_gte_multi = nullptr, run_gte_count = nullptr;
+  RunGteRankFn run_gte_rank = nullptr;
+  if (bitmapScan) {
+    run_gte_multi = lookupFn<RunGteMultiFn>(
+        *J, "run_gte_multi_" + std::to_string(numTests));
+    if (!run_gte_multi) {
+      return 1;
+    }
+  }
+  if (countScan) {
+    run_gte_count = lookupFn<RunGteMultiFn>(
+        *J, "run_gte_count_" + std::to_string(numTests));
+  } else {
+    run_gte_rank = lookupFn<RunGteRankFn>(
+        *J, "run_gte_rank_" + std::to_string(rankSlots));
+  }
+  if (!run_gte_count && !run_gte_rank) {
     return 1;
   }
 
-  using RunGteFn = void(*)(int*, int, int*, int);
-#if LLVM_VERSION_MAJOR >= 17
-  RunGteFn run_gte = Sym->toPtr<RunGteFn>();
-#else
-  RunGteFn run_gte = reinterpret_cast<RunGteFn>(Sym->getAddress());
-#endif
-
-  // 6) Execute like a normal function
-  int n, testValue;
-  std::cin >> n;
-  std::cin >> testValue;
-  std::vector<int> values = generate(n);
-  std::vector<int> results(values.size(), 0);
-
+  // 7) Execute like a normal function
   clock_t st = clock();
-  run_gte(values.data(), static_cast<int>(values.size()),
-          results.data(), testValue);
+  run_gte(values.data(), values.size(), results.data(), testValue);
   clock_t en = clock();
   double gen = ((en - st) / (CLOCKS_PER_SEC * 1.0));
 
@@ -224,5 +1233,181 @@ int main() {
   
   std::cerr << "generated: " << gen << std::endl;
   std::cerr << "manual: " << man << std::endl;
-  return 0;
+
+  // 8) Filter + project numPayloads columns
+  std::vector<std::unique_ptr<HugePageBuffer<int>>> payloadBufs, outBufs;
+  std::vector<int*> payloadCols, outCols;
+  for (int p = 0; p < numPayloads; p++) {
+    payloadBufs.push_back(std::make_unique<HugePageBuffer<int>>(n));
+    outBufs.push_back(std::make_unique<HugePageBuffer<int>>(n));
+    if (!payloadBufs.back()->ok() || !outBufs.back()->ok()) {
+      errs() << "failed to map payload columns\n";
+      return 1;
+    }
+    generate(payloadBufs.back()->data(), n);
+    payloadCols.push_back(payloadBufs.back()->data());
+    outCols.push_back(outBufs.back()->data());
+  }
+  HugePageBuffer<int64_t> selection(n);
+  HugePageBuffer<int> expected(n);
+  if (!selection.ok() || !expected.ok()) {
+    errs() << "failed to map " << n << " rows\n";
+    return 1;
+  }
+
+  st = clock();
+  int64_t matched = run_gte_gather(values.data(), n, testValue,
+                                   payloadCols.data(), outCols.data());
+  en = clock();
+  double fused = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+
+  // Check the fused output against the two-pass version column by column.
+  bool ok = true;
+  for (int p = 0; p < numPayloads && ok; p++) {
+    int* dest[] = { expected.data() };
+    int64_t k = manualGather(values.data(), n, testValue, &payloadCols[p], dest,
+                             1, selection.data());
+    ok = k == matched &&
+         std::equal(expected.data(), expected.data() + k, outCols[p]);
+  }
+
+  st = clock();
+  manualGather(values.data(), n, testValue, payloadCols.data(), outCols.data(),
+               numPayloads, selection.data());
+  en = clock();
+  double twoPass = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+
+  std::cerr << "gather (" << numPayloads << " payloads, "
+            << (useCompress ? "compress" : "branch-free") << "): " << fused
+            << (ok ? "" : " MISMATCH") << std::endl;
+  std::cerr << "manual gather: " << twoPass << std::endl;
+
+  // Sections 9 and 10 keep extra copies, bitmaps and sorts of the column, so
+  // they only use its first demoRows rows and stay runnable at full size.
+  const int64_t sample = std::min(n, demoRows);
+  std::cerr << "demos on " << sample << " of " << n << " rows" << std::endl;
+
+  // 9) numTests concurrent thresholds over the same column: one run_gte pass
+  //    per threshold, against a single shared scan
+  std::vector<int> tests(numTests);
+  generate(tests.data(), numTests);
+  std::vector<int64_t> counts(numTests), expectedCounts(numTests);
+  manualMultiCounts(values.data(), sample, tests, expectedCounts.data());
+
+  st = clock();
+  for (int t = 0; t < numTests; t++) {
+    run_gte(values.data(), sample, results.data(), tests[t]);
+  }
+  en = clock();
+  double perQuery = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+  std::cerr << numTests << " x run_gte: " << perQuery << std::endl;
+
+  bool multiOk = true;
+  if (bitmapScan) {
+    std::vector<std::vector<uint8_t>> bitmapBufs(numTests,
+                                                 std::vector<uint8_t>((sample + 7) / 8));
+    std::vector<uint8_t*> bitmaps;
+    for (auto& buf : bitmapBufs) {
+      bitmaps.push_back(buf.data());
+    }
+    st = clock();
+    run_gte_multi(values.data(), sample, tests.data(), counts.data(), bitmaps.data());
+    en = clock();
+    double multi = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+    multiOk = counts == expectedCounts;
+    for (int t = 0; t < numTests && multiOk; t++) {
+      for (int64_t idx = 0; idx < sample && multiOk; idx++) {
+        multiOk = ((bitmaps[t][idx / 8] >> (idx % 8)) & 1) == (values.data()[idx] >= tests[t]);
+      }
+    }
+    std::cerr << "shared scan, bitmaps: " << multi << (multiOk ? "" : " MISMATCH")
+              << std::endl;
+  }
+
+  std::fill(counts.begin(), counts.end(), 0);
+  st = clock();
+  if (countScan) {
+    run_gte_count(values.data(), sample, tests.data(), counts.data(), nullptr);
+  } else {
+    multiGteCounts(run_gte_rank, rankSlots, values.data(), sample, tests, counts.data());
+  }
+  en = clock();
+  double countTime = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+  bool countsOk = counts == expectedCounts;
+  multiOk = multiOk && countsOk;
+  std::cerr << (countScan ? "shared scan, counts: "
+                          : "sort-and-rank counts (" + std::to_string(rankSlots) +
+                                " slots): ")
+            << countTime << (countsOk ? "" : " MISMATCH") << std::endl;
+
+  // 10) Sorted, appended-batches and clustered copies of the column, filtered
+  //     into row ranges and checked against the dense run_gte output
+  HugePageBuffer<int> sortedCol(sample), batchesCol(sample), clusteredCol(sample);
+  if (!sortedCol.ok() || !batchesCol.ok() || !clusteredCol.ok()) {
+    errs() << "failed to map " << sample << " rows\n";
+    return 1;
+  }
+  std::copy(values.data(), values.data() + sample, sortedCol.data());
+  std::sort(sortedCol.data(), sortedCol.data() + sample);
+  std::copy(values.data(), values.data() + sample, batchesCol.data());
+  const int64_t numBatches = 16;
+  for (int64_t b = 0; b < numBatches; b++) {
+    std::sort(batchesCol.data() + sample * b / numBatches,
+              batchesCol.data() + sample * (b + 1) / numBatches);
+  }
+  for (int64_t idx = 0; idx < sample; idx++) {
+    clusteredCol.data()[idx] = int(idx * 100000 / sample) + rand() % 100;
+  }
+  struct Layout {
+    const char* name;
+    int* data;
+  };
+  for (const Layout& layout : { Layout{ "sorted", sortedCol.data() },
+                                Layout{ "16 batches", batchesCol.data() },
+                                Layout{ "clustered", clusteredCol.data() },
+                                Layout{ "random", values.data() } }) {
+    st = clock();
+    ColumnOrder order = analyzeColumn(layout.data, sample);
+    en = clock();
+    double analyze = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+
+    std::vector<RowRange> ranges;
+    st = clock();
+    bool useRanges = filterGteRanges(layout.data, sample, order, testValue, ranges);
+    en = clock();
+    double ranged = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+
+    st = clock();
+    run_gte(layout.data, sample, results.data(), testValue);
+    en = clock();
+    double dense = ((en - st) / (CLOCKS_PER_SEC * 1.0));
+    if (!useRanges) {
+      std::cerr << layout.name << ": unordered, analyze " << analyze
+                << ", dense run_gte " << dense << std::endl;
+      continue;
+    }
+
+    bool rangesOk = true;
+    int64_t row = 0;
+    for (const RowRange& range : ranges) {
+      for (; row < range.begin && rangesOk; row++) {
+        rangesOk = results.data()[row] == 0;
+      }
+      for (; row < range.end && rangesOk; row++) {
+        rangesOk = results.data()[row] == 1;
+      }
+    }
+    for (; row < sample && rangesOk; row++) {
+      rangesOk = results.data()[row] == 0;
+    }
+    multiOk = multiOk && rangesOk;
+    std::cerr << layout.name << ": "
+              << (order.numRuns() > 0 ? std::to_string(order.numRuns()) + " runs"
+                                      : std::string("zone map"))
+              << ", analyze "
+              << analyze << ", ranges " << ranged << " (" << ranges.size()
+              << ")" << (rangesOk ? "" : " MISMATCH") << ", run_gte " << dense
+              << std::endl;
+  }
+  return ok && multiOk ? 0 : 1;
 }